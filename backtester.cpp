@@ -0,0 +1,48 @@
+#include "backtester.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+using json = nlohmann::json;
+
+json Backtester::run(SimulatedExchange& exchange, const Strategy& strategy) {
+    while (exchange.step()) {
+        if (strategy) {
+            strategy(exchange);
+        }
+    }
+    return exchange.summary();
+}
+
+std::vector<json> Backtester::sweep(const std::vector<json>& parameterSets, const Trial& trial, unsigned threads) {
+    std::vector<json> results(parameterSets.size());
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<unsigned>(threads, static_cast<unsigned>(std::max<std::size_t>(parameterSets.size(), 1)));
+
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        for (std::size_t i = next.fetch_add(1); i < parameterSets.size(); i = next.fetch_add(1)) {
+            json result{{"parameters", parameterSets[i]}};
+            try {
+                result["result"] = trial(parameterSets[i]);
+            } catch (const std::exception& e) {
+                result["error"] = e.what();
+            }
+            results[i] = std::move(result);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return results;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "simulated_exchange.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <functional>
+#include <vector>
+
+class Backtester {
+public:
+    // Called after every candle close with the exchange positioned at that
+    // candle.
+    using Strategy = std::function<void(SimulatedExchange&)>;
+
+    // Builds an exchange and strategy from one parameter set, runs it and
+    // returns its summary.
+    using Trial = std::function<nlohmann::json(const nlohmann::json& parameters)>;
+
+    static nlohmann::json run(SimulatedExchange& exchange, const Strategy& strategy);
+
+    // Runs the parameter sets across `threads` workers (one per core by
+    // default). Results keep the order of `parameterSets`; a trial that
+    // throws reports {"error": ...}.
+    static std::vector<nlohmann::json> sweep(const std::vector<nlohmann::json>& parameterSets,
+                                             const Trial& trial,
+                                             unsigned threads = 0);
+};
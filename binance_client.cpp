@@ -1,16 +1,28 @@
 #include "binance_client.hpp"
+#include "endpoint_pinner.hpp"
+#include "exchange_info.hpp"
+#include "order_journal.hpp"
+#include "rate_limiter.hpp"
+#include "request_metrics.hpp"
+#include "shared_transport.hpp"
 
 #include <curl/curl.h>
 #include <openssl/hmac.h>
 
+#include <algorithm>
+#include <charconv>
 #include <chrono>
 #include <cmath>
 #include <cctype>
-#include <iomanip>
+#include <cstdint>
+#include <mutex>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 using json = nlohmann::json;
@@ -23,11 +35,90 @@ size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
     return totalSize;
 }
 
+// Usage counters the exchange reports on every response; -1 when absent.
+struct RateHeaders {
+    int usedWeight = -1;
+    int orderCount = -1;
+};
+
+void read_counter(std::string_view line, std::string_view name, int& value) {
+    if (line.size() <= name.size() || line[name.size()] != ':') {
+        return;
+    }
+    for (std::size_t i = 0; i < name.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(line[i])) != name[i]) {
+            return;
+        }
+    }
+    std::size_t begin = name.size() + 1;
+    while (begin < line.size() && line[begin] == ' ') {
+        ++begin;
+    }
+    int parsed = 0;
+    if (std::from_chars(line.data() + begin, line.data() + line.size(), parsed).ec == std::errc{}) {
+        value = parsed;
+    }
+}
+
+size_t header_callback(char* buffer, size_t size, size_t nitems, void* userp) {
+    const size_t totalSize = size * nitems;
+    const std::string_view line(buffer, totalSize);
+    auto* headers = static_cast<RateHeaders*>(userp);
+    read_counter(line, "x-mbx-used-weight-1m", headers->usedWeight);
+    read_counter(line, "x-mbx-order-count-10s", headers->orderCount);
+    return totalSize;
+}
+
 long long current_timestamp_ms() {
     using namespace std::chrono;
     return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
 }
 
+long long elapsed_ns(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+
+// Fills the network stages from curl's cumulative transfer timers.
+void fill_transfer_stages(CURL* curl, RequestMetrics::Trace& trace) {
+    curl_off_t nameLookup = 0;
+    curl_off_t connect = 0;
+    curl_off_t appConnect = 0;
+    curl_off_t startTransfer = 0;
+    curl_off_t total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &nameLookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &startTransfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+    using Stage = RequestMetrics::Stage;
+    // A reused connection does no lookup, connect or handshake. libcurl still
+    // reports near-zero times for them, which would drag those stages'
+    // statistics towards zero, so they are left unset.
+    const bool reused = connects == 0;
+    if (!reused) {
+        trace.set(Stage::NAME_LOOKUP, nameLookup * 1000);
+        if (connect > 0) {
+            trace.set(Stage::CONNECT, (connect - nameLookup) * 1000);
+        }
+        if (appConnect > 0) {
+            trace.set(Stage::TLS, (appConnect - connect) * 1000);
+        }
+    }
+    if (startTransfer > 0) {
+        const curl_off_t connected = reused ? 0 : std::max(connect, appConnect);
+        trace.set(Stage::TTFB, (startTransfer - connected) * 1000);
+        trace.set(Stage::TRANSFER, (total - startTransfer) * 1000);
+    }
+}
+
+long long current_timestamp_ns() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
+
 std::string uppercase(std::string value) {
     for (auto& c : value) {
         c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
@@ -41,8 +132,32 @@ std::string pick_position_side(const json& position) {
     }
     return "BOTH";
 }
+
+void reject_locally(ExchangeInfoCache::Verdict verdict) {
+    if (verdict != ExchangeInfoCache::Verdict::OK) {
+        throw LocalRejectionError(ExchangeInfoCache::errorCode(verdict), ExchangeInfoCache::message(verdict));
+    }
+}
+
+int read_leverage(const json& entry) {
+    auto it = entry.find("leverage");
+    if (it == entry.end()) {
+        return 0;
+    }
+    return it->is_string() ? std::stoi(it->get<std::string>()) : it->get<int>();
+}
 }  // namespace
 
+LocalRejectionError::LocalRejectionError(int code, const std::string& message)
+    : std::runtime_error("Rejected locally: " + json{{"code", code}, {"msg", message}}.dump()),
+      code_(code) {
+}
+
+struct BinanceFuturesClient::LeverageTable {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, int> bySymbol;
+};
+
 BinanceFuturesClient::BinanceFuturesClient(std::string apiKey,
                                            std::string secretKey,
                                            bool useTestnet,
@@ -50,29 +165,36 @@ BinanceFuturesClient::BinanceFuturesClient(std::string apiKey,
     : apiKey_(std::move(apiKey)),
       secretKey_(std::move(secretKey)),
       baseUrl_(useTestnet ? "https://testnet.binancefuture.com" : "https://fapi.binance.com"),
-      recvWindow_(recvWindow) {
+      recvWindow_(recvWindow),
+      leverage_(std::make_shared<LeverageTable>()) {
+    for (const auto& endpoint : endpoints::kEndpoints) {
+        urls_[static_cast<std::size_t>(endpoint.id)] = baseUrl_ + std::string(endpoint.path);
+    }
 }
 
-std::string BinanceFuturesClient::buildQuery(void* curlHandle, const Params& params) const {
-    std::string query;
-    CURL* curl = static_cast<CURL*>(curlHandle);
-    for (const auto& [key, value] : params) {
-        if (value.empty()) {
-            continue;
-        }
-        char* encoded = curl_easy_escape(curl, value.c_str(), static_cast<int>(value.size()));
-        if (!encoded) {
-            throw std::runtime_error("Failed to URL encode parameter");
-        }
-        if (!query.empty()) {
-            query.push_back('&');
-        }
-        query += key;
-        query.push_back('=');
-        query += encoded;
-        curl_free(encoded);
-    }
-    return query;
+void BinanceFuturesClient::setMetrics(std::shared_ptr<RequestMetrics> metrics) {
+    metrics_ = std::move(metrics);
+}
+
+void BinanceFuturesClient::setTransport(std::shared_ptr<SharedTransport> transport) {
+    transport_ = std::move(transport);
+}
+
+void BinanceFuturesClient::setEndpointPinner(std::shared_ptr<EndpointPinner> pinner) {
+    pinner_ = std::move(pinner);
+}
+
+void BinanceFuturesClient::setExchangeInfo(std::shared_ptr<ExchangeInfoCache> exchangeInfo) {
+    exchangeInfo_ = std::move(exchangeInfo);
+}
+
+void BinanceFuturesClient::setJournal(std::shared_ptr<OrderJournal> journal) {
+    journal_ = std::move(journal);
+}
+
+void BinanceFuturesClient::setRateLimits(std::shared_ptr<RateLimiter> weightLimiter, std::shared_ptr<RateLimiter> orderLimiter) {
+    weightLimiter_ = std::move(weightLimiter);
+    orderLimiter_ = std::move(orderLimiter);
 }
 
 std::string BinanceFuturesClient::sign(const std::string& payload) const {
@@ -83,61 +205,116 @@ std::string BinanceFuturesClient::sign(const std::string& payload) const {
         throw std::runtime_error("Failed to sign payload");
     }
 
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0');
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string hex(static_cast<std::size_t>(len) * 2, '\0');
     for (unsigned int i = 0; i < len; ++i) {
-        oss << std::setw(2) << static_cast<int>(result[i]);
+        hex[2 * i] = kHex[result[i] >> 4];
+        hex[2 * i + 1] = kHex[result[i] & 0x0F];
     }
-    return oss.str();
+    return hex;
 }
 
-json BinanceFuturesClient::performRequest(const std::string& method,
-                                          const std::string& path,
-                                          const Params& params,
-                                          bool isSigned) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to initialise curl");
+template <typename Request>
+json BinanceFuturesClient::send(const Request& request, std::string_view clientOrderId) {
+    constexpr const endpoints::EndpointInfo& endpoint = endpoints::info(Request::id);
+
+    if (weightLimiter_ && request.weight() > 0) {
+        weightLimiter_->acquire(request.weight());
+    }
+    if (orderLimiter_ && request.orders() > 0) {
+        orderLimiter_->acquire(request.orders());
     }
 
-    std::string url = baseUrl_ + path;
-    std::string body;
+    RequestMetrics* metrics = metrics_.get();
+    std::chrono::steady_clock::time_point encodeStart;
+    if (metrics) {
+        encodeStart = std::chrono::steady_clock::now();
+    }
 
-    std::string query = buildQuery(curl, params);
+    std::string query;
+    query.reserve(256);
+    endpoints::QueryWriter writer(query);
+    request.encode(writer);
+
+    std::int64_t encodeNs = -1;
+    if (metrics) {
+        encodeNs = elapsed_ns(encodeStart, std::chrono::steady_clock::now());
+    }
+
+    return performRequest(endpoint, query, clientOrderId, encodeNs);
+}
+
+json BinanceFuturesClient::performRequest(const endpoints::EndpointInfo& endpoint,
+                                          std::string& query,
+                                          std::string_view clientOrderId,
+                                          std::int64_t encodeNs) {
+    using Clock = std::chrono::steady_clock;
+    using Stage = RequestMetrics::Stage;
+    using endpoints::HttpMethod;
+
+    const std::string_view method = endpoints::method_name(endpoint.method);
+    const bool isSigned = endpoint.isSigned;
+
+    RequestMetrics* metrics = metrics_.get();
+    RequestMetrics::Trace trace;
+    Clock::time_point stageStart;
+    if (metrics) {
+        trace.endpoint = endpoint.id;
+        trace.set(Stage::ENCODE, encodeNs);
+        stageStart = Clock::now();
+    }
 
-    std::string signedQuery = query;
     if (isSigned) {
         if (apiKey_.empty() || secretKey_.empty()) {
-            curl_easy_cleanup(curl);
             throw std::runtime_error("API key and secret are required for private endpoints");
         }
-        if (!signedQuery.empty()) {
-            signedQuery.push_back('&');
-        }
-        signedQuery += "timestamp=" + std::to_string(current_timestamp_ms());
+        endpoints::QueryWriter writer(query);
+        writer.addInteger("timestamp", current_timestamp_ms());
         if (recvWindow_ > 0) {
-            signedQuery += "&recvWindow=" + std::to_string(recvWindow_);
+            writer.addInteger("recvWindow", recvWindow_);
+        }
+        const std::string signature = sign(query);
+        query += "&signature=";
+        query += signature;
+        if (metrics) {
+            trace.set(Stage::SIGN, elapsed_ns(stageStart, Clock::now()));
         }
-        const std::string signature = sign(signedQuery);
-        signedQuery += "&signature=" + signature;
     }
 
-    if (method == "GET" || method == "DELETE") {
-        if (!signedQuery.empty()) {
-            url += "?";
-            url += signedQuery;
-        }
-    } else {
-        body = isSigned ? signedQuery : query;
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        throw std::runtime_error("Failed to initialise curl");
+    }
+
+    const std::string& baseUrl = urls_[static_cast<std::size_t>(endpoint.id)];
+    std::string url;
+    const bool queryInUrl = endpoint.method != HttpMethod::POST;
+    if (queryInUrl && !query.empty()) {
+        url.reserve(baseUrl.size() + 1 + query.size());
+        url += baseUrl;
+        url.push_back('?');
+        url += query;
     }
 
     std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_URL, url.empty() ? baseUrl.c_str() : url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    RateHeaders rateHeaders;
+    if (weightLimiter_ || orderLimiter_) {
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &rateHeaders);
+    }
+    if (transport_) {
+        transport_->attach(curl);
+    }
+    std::shared_ptr<const void> pinnedResolve;
+    if (pinner_) {
+        pinnedResolve = pinner_->apply(curl);
+    }
 
     struct curl_slist* headers = nullptr;
     if (isSigned && !apiKey_.empty()) {
@@ -145,28 +322,71 @@ json BinanceFuturesClient::performRequest(const std::string& method,
         headers = curl_slist_append(headers, header.c_str());
     }
 
-    if (method == "POST") {
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
-    } else if (method == "DELETE") {
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+    switch (endpoint.method) {
+        case HttpMethod::POST:
+            curl_easy_setopt(curl, CURLOPT_POST, 1L);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, query.c_str());
+            break;
+        case HttpMethod::DELETE:
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+            break;
+        default:
+            break;
     }
 
     if (headers) {
         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     }
 
+    const long long sentAtNs = current_timestamp_ns();
+    const auto started = Clock::now();
+
     CURLcode res = curl_easy_perform(curl);
 
+    const auto latency = Clock::now() - started;
+
     long httpStatus = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpStatus);
 
+    if (metrics) {
+        trace.httpStatus = res == CURLE_OK ? httpStatus : 0;
+        trace.set(Stage::TOTAL, elapsed_ns(started, started + latency));
+        fill_transfer_stages(curl, trace);
+    }
+
+    // The exchange's own count also covers requests this process did not
+    // make through these limiters, e.g. other processes on the same IP.
+    const RateLimiter::Clock::time_point sentAt{
+        std::chrono::duration_cast<RateLimiter::Clock::duration>(std::chrono::nanoseconds(sentAtNs))};
+    if (weightLimiter_ && rateHeaders.usedWeight >= 0) {
+        weightLimiter_->sync(rateHeaders.usedWeight, sentAt);
+    }
+    if (orderLimiter_ && rateHeaders.orderCount >= 0) {
+        orderLimiter_->sync(rateHeaders.orderCount, sentAt);
+    }
+
+    if (pinner_ && (res == CURLE_COULDNT_CONNECT || res == CURLE_OPERATION_TIMEDOUT || res == CURLE_SSL_CONNECT_ERROR)) {
+        char* primaryIp = nullptr;
+        if (curl_easy_getinfo(curl, CURLINFO_PRIMARY_IP, &primaryIp) == CURLE_OK && primaryIp && *primaryIp) {
+            pinner_->reportFailure(primaryIp);
+        }
+    }
+
+    if (journal_ && isSigned) {
+        journal_->record(method, endpoint.path, query, response, clientOrderId, httpStatus, static_cast<int>(res), sentAtNs,
+                         static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+    }
+
     if (headers) {
         curl_slist_free_all(headers);
     }
 
     curl_easy_cleanup(curl);
 
+    if (metrics && (res != CURLE_OK || httpStatus >= 400 || response.empty())) {
+        metrics->record(trace);
+    }
+
     if (res != CURLE_OK) {
         std::ostringstream oss;
         oss << "curl_easy_perform() failed: " << curl_easy_strerror(res);
@@ -174,23 +394,29 @@ json BinanceFuturesClient::performRequest(const std::string& method,
     }
 
     if (httpStatus >= 400) {
-        std::ostringstream oss;
-        oss << "HTTP error " << httpStatus << ": " << response;
-        throw std::runtime_error(oss.str());
+        throw HttpError(httpStatus, std::move(response));
     }
 
     if (response.empty()) {
         return json::object();
     }
 
-    return json::parse(response);
+    if (!metrics) {
+        return json::parse(response);
+    }
+
+    const auto parseStart = Clock::now();
+    json parsed = json::parse(response);
+    trace.set(Stage::PARSE, elapsed_ns(parseStart, Clock::now()));
+    metrics->record(trace);
+    return parsed;
 }
 
-std::string BinanceFuturesClient::toString(Side side) {
+std::string_view BinanceFuturesClient::toString(Side side) {
     return side == Side::BUY ? "BUY" : "SELL";
 }
 
-std::string BinanceFuturesClient::toString(OrderType type) {
+std::string_view BinanceFuturesClient::toString(OrderType type) {
     switch (type) {
         case OrderType::MARKET:
             return "MARKET";
@@ -205,7 +431,7 @@ std::string BinanceFuturesClient::toString(OrderType type) {
     }
 }
 
-std::string BinanceFuturesClient::toString(TimeInForce tif) {
+std::string_view BinanceFuturesClient::toString(TimeInForce tif) {
     switch (tif) {
         case TimeInForce::GTC:
             return "GTC";
@@ -220,120 +446,154 @@ std::string BinanceFuturesClient::toString(TimeInForce tif) {
     }
 }
 
-std::string BinanceFuturesClient::formatDouble(double value) {
-    std::ostringstream oss;
-    oss.setf(std::ios::fixed);
-    oss << std::setprecision(8) << value;
-    std::string str = oss.str();
-    auto pos = str.find_last_not_of('0');
-    if (pos != std::string::npos) {
-        if (str[pos] == '.') {
-            str.erase(pos);
-        } else {
-            str.erase(pos + 1);
-        }
-    }
-    if (str.empty()) {
-        return "0";
-    }
-    return str;
-}
-
 json BinanceFuturesClient::getContinuousKlines(const std::string& pair,
                                                const std::string& interval,
                                                int limit,
                                                const std::string& contractType) {
-    Params params{
-        {"pair", pair},
-        {"contractType", contractType},
-        {"interval", interval},
-        {"limit", std::to_string(limit)}
-    };
-    return performRequest("GET", "/fapi/v1/continuousKlines", params, false);
+    return send(endpoints::ContinuousKlines{pair, contractType, interval, limit});
 }
 
 json BinanceFuturesClient::setLeverage(const std::string& symbol, int leverage) {
-    Params params{
-        {"symbol", uppercase(symbol)},
-        {"leverage", std::to_string(leverage)}
-    };
-    return performRequest("POST", "/fapi/v1/leverage", params, true);
+    const std::string normalisedSymbol = uppercase(symbol);
+    json response = send(endpoints::Leverage{normalisedSymbol, leverage});
+    rememberLeverage(normalisedSymbol, read_leverage(response));
+    return response;
 }
 
-json BinanceFuturesClient::placeOrder(const OrderRequest& request) {
-    Params params{
-        {"symbol", uppercase(request.symbol)},
-        {"side", toString(request.side)},
-        {"type", toString(request.type)}
-    };
+void BinanceFuturesClient::rememberLeverage(const std::string& symbol, int leverage) {
+    if (leverage <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(leverage_->mutex);
+    leverage_->bySymbol[symbol] = leverage;
+}
 
-    if (request.quantity) {
-        params.emplace_back("quantity", formatDouble(*request.quantity));
+int BinanceFuturesClient::knownLeverage(const std::string& symbol) const {
+    std::lock_guard<std::mutex> lock(leverage_->mutex);
+    auto it = leverage_->bySymbol.find(symbol);
+    return it == leverage_->bySymbol.end() ? 0 : it->second;
+}
+
+json BinanceFuturesClient::placeOrder(const OrderRequest& request) {
+    if (!request.quantity && !request.quoteOrderQty) {
+        throw std::runtime_error("Either quantity or quoteOrderQty must be provided");
     }
-    if (request.quoteOrderQty) {
-        params.emplace_back("quoteOrderQty", formatDouble(*request.quoteOrderQty));
+
+    const std::string symbol = uppercase(request.symbol);
+    const std::string positionSide = request.positionSide ? uppercase(*request.positionSide) : std::string{};
+    const std::string_view clientOrderId = request.clientOrderId ? std::string_view(*request.clientOrderId) : std::string_view{};
+
+    std::shared_ptr<const ExchangeInfoCache::SymbolRules> rules;
+    if (exchangeInfo_) {
+        // Reloads run on the cache's own thread (ExchangeInfoCache::start);
+        // only a cache that has never loaded is filled here, once for all
+        // orders waiting on it.
+        if (!exchangeInfo_->loaded()) {
+            exchangeInfo_->refresh(*this);
+        }
+        rules = exchangeInfo_->rules(symbol);
+        if (!rules) {
+            reject_locally(ExchangeInfoCache::Verdict::UNKNOWN_SYMBOL);
+        }
+        ExchangeInfoCache::OrderCheck check;
+        check.market = request.type != OrderType::LIMIT;
+        check.reduceOnly = request.reduceOnly.value_or(false);
+        check.quantity = request.quantity;
+        check.price = request.price;
+        check.stopPrice = request.stopPrice;
+        if (!rules->brackets.empty()) {
+            check.leverage = knownLeverage(symbol);
+        }
+        reject_locally(ExchangeInfoCache::validate(*rules, check));
+        // Protective orders are only sent after the entry fills, so their
+        // trigger prices are checked up front too.
+        for (const auto& protectivePrice : {request.stopLossPrice, request.takeProfitPrice}) {
+            if (protectivePrice) {
+                ExchangeInfoCache::OrderCheck protective;
+                protective.market = true;
+                protective.reduceOnly = true;
+                protective.stopPrice = protectivePrice;
+                reject_locally(ExchangeInfoCache::validate(*rules, protective));
+            }
+        }
     }
-    if (request.price) {
-        params.emplace_back("price", formatDouble(*request.price));
+
+    endpoints::NewOrder order;
+    order.symbol = symbol;
+    order.side = toString(request.side);
+    order.type = toString(request.type);
+    order.quoteOrderQty = request.quoteOrderQty;
+    std::string quantityText;
+    std::string priceText;
+    std::string stopPriceText;
+    if (rules) {
+        if (request.quantity) {
+            quantityText = ExchangeInfoCache::formatQuantity(*rules, *request.quantity);
+        }
+        if (request.price) {
+            priceText = ExchangeInfoCache::formatPrice(*rules, *request.price);
+        }
+        if (request.stopPrice) {
+            stopPriceText = ExchangeInfoCache::formatPrice(*rules, *request.stopPrice);
+        }
+        order.quantityText = quantityText;
+        order.priceText = priceText;
+        order.stopPriceText = stopPriceText;
+    } else {
+        order.quantity = request.quantity;
+        order.price = request.price;
+        order.stopPrice = request.stopPrice;
     }
     if (request.timeInForce) {
-        params.emplace_back("timeInForce", toString(*request.timeInForce));
-    }
-    if (request.reduceOnly) {
-        params.emplace_back("reduceOnly", *request.reduceOnly ? "true" : "false");
-    }
-    if (request.positionSide) {
-        params.emplace_back("positionSide", uppercase(*request.positionSide));
-    }
-    if (request.clientOrderId) {
-        params.emplace_back("newClientOrderId", *request.clientOrderId);
-    }
-    if (request.stopPrice) {
-        params.emplace_back("stopPrice", formatDouble(*request.stopPrice));
-    }
-
-    if (!request.quantity && !request.quoteOrderQty) {
-        throw std::runtime_error("Either quantity or quoteOrderQty must be provided");
+        order.timeInForce = toString(*request.timeInForce);
     }
+    order.reduceOnly = request.reduceOnly;
+    order.positionSide = positionSide;
+    order.clientOrderId = clientOrderId;
 
     json result;
-    json entry = performRequest("POST", "/fapi/v1/order", params, true);
+    json entry = send(order, clientOrderId);
     result["entry"] = entry;
 
     const auto executedQty = entry.value("executedQty", entry.value("origQty", std::string{}));
 
-    auto createOcoOrder = [&](const std::optional<double>& priceValue, const std::string& orderType) -> std::optional<json> {
+    auto createOcoOrder = [&](const std::optional<double>& priceValue, OrderType orderType) -> std::optional<json> {
         if (!priceValue) {
             return std::nullopt;
         }
-        Params extra{
-            {"symbol", uppercase(request.symbol)},
-            {"side", request.side == Side::BUY ? "SELL" : "BUY"},
-            {"type", orderType},
-            {"stopPrice", formatDouble(*priceValue)},
-            {"reduceOnly", "true"},
-            {"workingType", "MARK_PRICE"}
-        };
+        endpoints::NewOrder extra;
+        extra.symbol = symbol;
+        extra.side = toString(request.side == Side::BUY ? Side::SELL : Side::BUY);
+        extra.type = toString(orderType);
+        std::string triggerText;
+        if (rules) {
+            triggerText = ExchangeInfoCache::formatPrice(*rules, *priceValue);
+            extra.stopPriceText = triggerText;
+        } else {
+            extra.stopPrice = *priceValue;
+        }
+        extra.reduceOnly = true;
+        extra.workingType = "MARK_PRICE";
 
         if (!executedQty.empty()) {
-            extra.emplace_back("quantity", executedQty);
+            extra.quantityText = executedQty;
+        } else if (request.quantity && rules) {
+            extra.quantityText = quantityText;
         } else if (request.quantity) {
-            extra.emplace_back("quantity", formatDouble(*request.quantity));
+            extra.quantity = *request.quantity;
         } else {
             throw std::runtime_error("Unable to determine quantity for protective order");
         }
 
-        if (request.positionSide) {
-            extra.emplace_back("positionSide", uppercase(*request.positionSide));
-        }
+        extra.positionSide = positionSide;
 
-        return performRequest("POST", "/fapi/v1/order", extra, true);
+        return send(extra);
     };
 
-    if (auto stopLoss = createOcoOrder(request.stopLossPrice, "STOP_MARKET")) {
+    if (auto stopLoss = createOcoOrder(request.stopLossPrice, OrderType::STOP_MARKET)) {
         result["stopLoss"] = *stopLoss;
     }
-    if (auto takeProfit = createOcoOrder(request.takeProfitPrice, "TAKE_PROFIT_MARKET")) {
+    if (auto takeProfit = createOcoOrder(request.takeProfitPrice, OrderType::TAKE_PROFIT_MARKET)) {
         result["takeProfit"] = *takeProfit;
     }
 
@@ -341,49 +601,63 @@ json BinanceFuturesClient::placeOrder(const OrderRequest& request) {
 }
 
 json BinanceFuturesClient::getOpenOrders(const std::string& symbol) {
-    Params params;
-    if (!symbol.empty()) {
-        params.emplace_back("symbol", uppercase(symbol));
-    }
-    return performRequest("GET", "/fapi/v1/openOrders", params, true);
+    const std::string normalisedSymbol = uppercase(symbol);
+    return send(endpoints::OpenOrders{normalisedSymbol});
 }
 
 json BinanceFuturesClient::getAllOrders(const std::string& symbol, int limit) {
-    Params params{
-        {"symbol", uppercase(symbol)},
-        {"limit", std::to_string(limit)}
-    };
-    return performRequest("GET", "/fapi/v1/allOrders", params, true);
+    const std::string normalisedSymbol = uppercase(symbol);
+    return send(endpoints::AllOrders{normalisedSymbol, limit, std::nullopt, std::nullopt, std::nullopt});
+}
+
+json BinanceFuturesClient::getAllOrders(const std::string& symbol, const HistoryRange& range, int limit) {
+    const std::string normalisedSymbol = uppercase(symbol);
+    return send(endpoints::AllOrders{normalisedSymbol, limit, range.fromId, range.startTime, range.endTime});
 }
 
 json BinanceFuturesClient::getAccountInfo() {
-    Params params;
-    return performRequest("GET", "/fapi/v2/account", params, true);
+    return send(endpoints::Account{});
 }
 
 json BinanceFuturesClient::getPositionRisk(const std::string& symbol) {
-    Params params;
-    if (!symbol.empty()) {
-        params.emplace_back("symbol", uppercase(symbol));
+    const std::string normalisedSymbol = uppercase(symbol);
+    json positions = send(endpoints::PositionRisk{normalisedSymbol});
+    if (positions.is_array()) {
+        for (const auto& position : positions) {
+            if (position.contains("symbol")) {
+                rememberLeverage(position.at("symbol").get<std::string>(), read_leverage(position));
+            }
+        }
     }
-    return performRequest("GET", "/fapi/v2/positionRisk", params, true);
+    return positions;
 }
 
 json BinanceFuturesClient::getFundingRate(const std::string& symbol, int limit) {
-    Params params{
-        {"symbol", uppercase(symbol)},
-        {"limit", std::to_string(limit)}
-    };
-    return performRequest("GET", "/fapi/v1/fundingRate", params, false);
+    const std::string normalisedSymbol = uppercase(symbol);
+    return send(endpoints::FundingRate{normalisedSymbol, limit});
+}
+
+json BinanceFuturesClient::getExchangeInfo() {
+    return send(endpoints::ExchangeInfo{});
+}
+
+json BinanceFuturesClient::getLeverageBrackets(const std::string& symbol) {
+    const std::string normalisedSymbol = uppercase(symbol);
+    return send(endpoints::LeverageBracket{normalisedSymbol});
 }
 
 json BinanceFuturesClient::getFundingFeeHistory(const std::string& symbol, int limit) {
-    Params params{
-        {"symbol", uppercase(symbol)},
-        {"incomeType", "FUNDING_FEE"},
-        {"limit", std::to_string(limit)}
-    };
-    return performRequest("GET", "/fapi/v1/income", params, true);
+    const std::string normalisedSymbol = uppercase(symbol);
+    return send(endpoints::Income{normalisedSymbol, "FUNDING_FEE", std::nullopt, std::nullopt, limit});
+}
+
+json BinanceFuturesClient::getIncomeHistory(const std::string& symbol,
+                                            const std::string& incomeType,
+                                            const HistoryRange& range,
+                                            int limit) {
+    const std::string normalisedSymbol = uppercase(symbol);
+    const std::string normalisedType = uppercase(incomeType);
+    return send(endpoints::Income{normalisedSymbol, normalisedType, range.startTime, range.endTime, limit});
 }
 
 json BinanceFuturesClient::closePosition(const std::string& symbol) {
@@ -393,8 +667,8 @@ json BinanceFuturesClient::closePosition(const std::string& symbol) {
     }
 
     std::string normalisedSymbol = uppercase(symbol);
-    std::string closeSide;
-    std::string quantity;
+    std::optional<Side> closeSide;
+    double quantity = 0.0;
     std::optional<std::string> positionSide;
 
     for (const auto& pos : positions) {
@@ -408,31 +682,29 @@ json BinanceFuturesClient::closePosition(const std::string& symbol) {
         if (std::fabs(positionAmt) < 1e-12) {
             continue;
         }
-        closeSide = positionAmt > 0 ? "SELL" : "BUY";
-        quantity = formatDouble(std::fabs(positionAmt));
+        closeSide = positionAmt > 0 ? Side::SELL : Side::BUY;
+        quantity = std::fabs(positionAmt);
         const std::string sideValue = pick_position_side(pos);
         if (sideValue != "BOTH") {
-            positionSide = sideValue;
+            positionSide = uppercase(sideValue);
         }
         break;
     }
 
-    if (closeSide.empty() || quantity.empty()) {
+    if (!closeSide) {
         return json{{"symbol", normalisedSymbol}, {"message", "No open position"}};
     }
 
-    Params params{
-        {"symbol", normalisedSymbol},
-        {"side", closeSide},
-        {"type", "MARKET"},
-        {"quantity", quantity},
-        {"reduceOnly", "true"}
-    };
-
+    endpoints::NewOrder order;
+    order.symbol = normalisedSymbol;
+    order.side = toString(*closeSide);
+    order.type = toString(OrderType::MARKET);
+    order.quantity = quantity;
+    order.reduceOnly = true;
     if (positionSide) {
-        params.emplace_back("positionSide", uppercase(*positionSide));
+        order.positionSide = *positionSide;
     }
 
-    json response = performRequest("POST", "/fapi/v1/order", params, true);
+    json response = send(order);
     return json{{"symbol", normalisedSymbol}, {"close", response}};
 }
@@ -1,11 +1,57 @@
 #pragma once
 
+#include "binance_endpoints.hpp"
+
 #include <nlohmann/json.hpp>
 
+#include <array>
+#include <cstdint>
+
+#include <memory>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+class OrderJournal;
+class EndpointPinner;
+class ExchangeInfoCache;
+class RateLimiter;
+class RequestMetrics;
+class SharedTransport;
+
+// Thrown for an order that failed local validation and was never sent. The
+// code and message are the ones the exchange would have answered with.
+class LocalRejectionError : public std::runtime_error {
+public:
+    LocalRejectionError(int code, const std::string& message);
+
+    int code() const { return code_; }
+
+private:
+    int code_;
+};
+
+// Thrown for an HTTP error status. `body` is the exchange's answer, usually
+// a {"code","msg"} object. Defined inline so the simulator, which raises it
+// too, does not have to link the client.
+class HttpError : public std::runtime_error {
+public:
+    HttpError(long status, std::string body)
+        : std::runtime_error("HTTP error " + std::to_string(status) + ": " + body),
+          status_(status),
+          body_(std::move(body)) {}
+
+    long status() const { return status_; }
+    const std::string& body() const { return body_; }
+
+private:
+    long status_;
+    std::string body_;
+};
+
 class BinanceFuturesClient {
 public:
     enum class Side { BUY, SELL };
@@ -38,8 +84,39 @@ public:
         std::optional<double> stopLossPrice;
     };
 
+    struct HistoryRange {
+        std::optional<long long> startTime;
+        std::optional<long long> endTime;
+        std::optional<long long> fromId;
+    };
+
     BinanceFuturesClient(std::string apiKey, std::string secretKey, bool useTestnet = true, long recvWindow = 5000);
 
+    void setJournal(std::shared_ptr<OrderJournal> journal);
+
+    void setMetrics(std::shared_ptr<RequestMetrics> metrics);
+
+    void setTransport(std::shared_ptr<SharedTransport> transport);
+
+    // Routes requests to the pinner's fastest addresses and reports
+    // connection failures back to it so it can fail over.
+    void setEndpointPinner(std::shared_ptr<EndpointPinner> pinner);
+
+    // Validates orders against cached symbol rules before sending them and
+    // formats their prices and quantities at each symbol's exact precision.
+    // Invalid orders throw LocalRejectionError. The leverage bracket check
+    // uses the leverage last set or reported for the symbol by this client.
+    // Keeping the cache current is its owner's job (ExchangeInfoCache::start);
+    // the client only loads it if it is still empty.
+    void setExchangeInfo(std::shared_ptr<ExchangeInfoCache> exchangeInfo);
+
+    // Charges each request's exact endpoint weight to `weightLimiter` and its
+    // order count to `orderLimiter` before sending. Either may be null. The
+    // limiters are also synced with the X-MBX-USED-WEIGHT-1M and
+    // X-MBX-ORDER-COUNT-10S counts the exchange returns, so they are expected
+    // to use one-minute and ten-second windows respectively.
+    void setRateLimits(std::shared_ptr<RateLimiter> weightLimiter, std::shared_ptr<RateLimiter> orderLimiter);
+
     nlohmann::json getContinuousKlines(const std::string& pair,
                                        const std::string& interval,
                                        int limit = 500,
@@ -53,6 +130,8 @@ public:
 
     nlohmann::json getAllOrders(const std::string& symbol, int limit = 500);
 
+    nlohmann::json getAllOrders(const std::string& symbol, const HistoryRange& range, int limit = 1000);
+
     nlohmann::json getAccountInfo();
 
     nlohmann::json getPositionRisk(const std::string& symbol = "");
@@ -61,28 +140,48 @@ public:
 
     nlohmann::json getFundingFeeHistory(const std::string& symbol, int limit = 10);
 
+    nlohmann::json getIncomeHistory(const std::string& symbol,
+                                    const std::string& incomeType,
+                                    const HistoryRange& range,
+                                    int limit = 1000);
+
     nlohmann::json closePosition(const std::string& symbol);
 
-private:
-    using Params = std::vector<std::pair<std::string, std::string>>;
+    nlohmann::json getExchangeInfo();
+
+    nlohmann::json getLeverageBrackets(const std::string& symbol = "");
 
-    nlohmann::json performRequest(const std::string& method,
-                                  const std::string& path,
-                                  const Params& params,
-                                  bool isSigned);
+private:
+    template <typename Request>
+    nlohmann::json send(const Request& request, std::string_view clientOrderId = {});
 
-    std::string buildQuery(void* curlHandle, const Params& params) const;
+    nlohmann::json performRequest(const endpoints::EndpointInfo& endpoint,
+                                  std::string& query,
+                                  std::string_view clientOrderId,
+                                  std::int64_t encodeNs);
 
     std::string sign(const std::string& payload) const;
 
-    static std::string toString(Side side);
-    static std::string toString(OrderType type);
-    static std::string toString(TimeInForce tif);
+    static std::string_view toString(Side side);
+    static std::string_view toString(OrderType type);
+    static std::string_view toString(TimeInForce tif);
 
-    static std::string formatDouble(double value);
+    void rememberLeverage(const std::string& symbol, int leverage);
+    int knownLeverage(const std::string& symbol) const;
 
     std::string apiKey_;
     std::string secretKey_;
     std::string baseUrl_;
+    std::array<std::string, static_cast<std::size_t>(endpoints::EndpointId::COUNT)> urls_;
     long recvWindow_;
+    std::shared_ptr<OrderJournal> journal_;
+    std::shared_ptr<RequestMetrics> metrics_;
+    std::shared_ptr<SharedTransport> transport_;
+    std::shared_ptr<EndpointPinner> pinner_;
+    std::shared_ptr<ExchangeInfoCache> exchangeInfo_;
+    // Leverage per symbol from setLeverage and positionRisk responses.
+    struct LeverageTable;
+    std::shared_ptr<LeverageTable> leverage_;
+    std::shared_ptr<RateLimiter> weightLimiter_;
+    std::shared_ptr<RateLimiter> orderLimiter_;
 };
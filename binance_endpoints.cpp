@@ -0,0 +1,34 @@
+#include "binance_endpoints.hpp"
+#include "text_format.hpp"
+
+namespace endpoints {
+
+namespace {
+bool is_unreserved(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+           c == '~';
+}
+}  // namespace
+
+void QueryWriter::addDecimal(std::string_view key, double value) {
+    char buffer[kDecimalBufferSize];
+    const std::size_t length = format_decimal(buffer, value);
+    appendKey(key);
+    out_.append(buffer, length);
+}
+
+void QueryWriter::appendEscaped(std::string_view value) {
+    static constexpr char kHex[] = "0123456789ABCDEF";
+    for (char c : value) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (is_unreserved(byte)) {
+            out_.push_back(c);
+        } else {
+            out_.push_back('%');
+            out_.push_back(kHex[byte >> 4]);
+            out_.push_back(kHex[byte & 0x0F]);
+        }
+    }
+}
+
+}  // namespace endpoints
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace endpoints {
+
+enum class HttpMethod { GET, POST, DELETE };
+
+enum class EndpointId : std::size_t {
+    CONTINUOUS_KLINES,
+    LEVERAGE,
+    ORDER,
+    OPEN_ORDERS,
+    ALL_ORDERS,
+    ACCOUNT,
+    POSITION_RISK,
+    FUNDING_RATE,
+    INCOME,
+    EXCHANGE_INFO,
+    LEVERAGE_BRACKET,
+    COUNT
+};
+
+struct EndpointInfo {
+    EndpointId id;
+    HttpMethod method;
+    std::string_view path;
+    bool isSigned;
+};
+
+inline constexpr std::array<EndpointInfo, static_cast<std::size_t>(EndpointId::COUNT)> kEndpoints{{
+    {EndpointId::CONTINUOUS_KLINES, HttpMethod::GET, "/fapi/v1/continuousKlines", false},
+    {EndpointId::LEVERAGE, HttpMethod::POST, "/fapi/v1/leverage", true},
+    {EndpointId::ORDER, HttpMethod::POST, "/fapi/v1/order", true},
+    {EndpointId::OPEN_ORDERS, HttpMethod::GET, "/fapi/v1/openOrders", true},
+    {EndpointId::ALL_ORDERS, HttpMethod::GET, "/fapi/v1/allOrders", true},
+    {EndpointId::ACCOUNT, HttpMethod::GET, "/fapi/v2/account", true},
+    {EndpointId::POSITION_RISK, HttpMethod::GET, "/fapi/v2/positionRisk", true},
+    {EndpointId::FUNDING_RATE, HttpMethod::GET, "/fapi/v1/fundingRate", false},
+    {EndpointId::INCOME, HttpMethod::GET, "/fapi/v1/income", true},
+    {EndpointId::EXCHANGE_INFO, HttpMethod::GET, "/fapi/v1/exchangeInfo", false},
+    {EndpointId::LEVERAGE_BRACKET, HttpMethod::GET, "/fapi/v1/leverageBracket", true},
+}};
+
+constexpr const EndpointInfo& info(EndpointId id) {
+    return kEndpoints[static_cast<std::size_t>(id)];
+}
+
+constexpr bool table_is_ordered() {
+    for (std::size_t i = 0; i < kEndpoints.size(); ++i) {
+        if (static_cast<std::size_t>(kEndpoints[i].id) != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(table_is_ordered(), "kEndpoints must be listed in EndpointId order");
+
+constexpr std::string_view method_name(HttpMethod method) {
+    switch (method) {
+        case HttpMethod::GET:
+            return "GET";
+        case HttpMethod::POST:
+            return "POST";
+        default:
+            return "DELETE";
+    }
+}
+
+// Appends key=value pairs to a query string. Values are percent-encoded only
+// when they contain characters outside the unreserved set, which for the
+// symbols, enums and numbers sent here is never.
+class QueryWriter {
+public:
+    explicit QueryWriter(std::string& out) : out_(out) {}
+
+    void addString(std::string_view key, std::string_view value) {
+        if (value.empty()) {
+            return;
+        }
+        appendKey(key);
+        appendEscaped(value);
+    }
+
+    void addInteger(std::string_view key, long long value) {
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        appendKey(key);
+        out_.append(buffer, result.ptr);
+    }
+
+    void addBool(std::string_view key, bool value) {
+        appendKey(key);
+        out_ += value ? "true" : "false";
+    }
+
+    void addDecimal(std::string_view key, double value);
+
+    void addInteger(std::string_view key, const std::optional<long long>& value) {
+        if (value) {
+            addInteger(key, *value);
+        }
+    }
+
+    void addDecimal(std::string_view key, const std::optional<double>& value) {
+        if (value) {
+            addDecimal(key, *value);
+        }
+    }
+
+    void addBool(std::string_view key, const std::optional<bool>& value) {
+        if (value) {
+            addBool(key, *value);
+        }
+    }
+
+private:
+    void appendKey(std::string_view key) {
+        if (!out_.empty()) {
+            out_.push_back('&');
+        }
+        out_ += key;
+        out_.push_back('=');
+    }
+
+    void appendEscaped(std::string_view value);
+
+    std::string& out_;
+};
+
+// Request descriptors. Each one fixes its endpoint at compile time and knows
+// how to encode its own parameters and what it costs against the exchange's
+// request weight (per IP) and order count (per account) limits.
+
+struct ContinuousKlines {
+    static constexpr EndpointId id = EndpointId::CONTINUOUS_KLINES;
+    std::string_view pair;
+    std::string_view contractType;
+    std::string_view interval;
+    int limit;
+
+    int weight() const {
+        if (limit < 100) {
+            return 1;
+        }
+        if (limit < 500) {
+            return 2;
+        }
+        return limit <= 1000 ? 5 : 10;
+    }
+    int orders() const { return 0; }
+    void encode(QueryWriter& query) const {
+        query.addString("pair", pair);
+        query.addString("contractType", contractType);
+        query.addString("interval", interval);
+        query.addInteger("limit", limit);
+    }
+};
+
+struct Leverage {
+    static constexpr EndpointId id = EndpointId::LEVERAGE;
+    std::string_view symbol;
+    int leverage;
+
+    int weight() const { return 1; }
+    int orders() const { return 0; }
+    void encode(QueryWriter& query) const {
+        query.addString("symbol", symbol);
+        query.addInteger("leverage", leverage);
+    }
+};
+
+struct NewOrder {
+    static constexpr EndpointId id = EndpointId::ORDER;
+    std::string_view symbol;
+    std::string_view side;
+    std::string_view type;
+    std::optional<double> quantity;
+    // Quantity passed through verbatim, e.g. executedQty from a response.
+    std::string_view quantityText;
+    std::optional<double> quoteOrderQty;
+    std::optional<double> price;
+    // Prices pre-formatted at the symbol's precision, sent instead of the
+    // numeric fields when set.
+    std::string_view priceText;
+    std::string_view timeInForce;
+    std::optional<bool> reduceOnly;
+    std::string_view positionSide;
+    std::string_view clientOrderId;
+    std::optional<double> stopPrice;
+    std::string_view stopPriceText;
+    std::string_view workingType;
+
+    int weight() const { return 0; }
+    int orders() const { return 1; }
+    void encode(QueryWriter& query) const {
+        query.addString("symbol", symbol);
+        query.addString("side", side);
+        query.addString("type", type);
+        query.addDecimal("quantity", quantity);
+        query.addString("quantity", quantityText);
+        query.addDecimal("quoteOrderQty", quoteOrderQty);
+        query.addDecimal("price", price);
+        query.addString("price", priceText);
+        query.addString("timeInForce", timeInForce);
+        query.addBool("reduceOnly", reduceOnly);
+        query.addString("positionSide", positionSide);
+        query.addString("newClientOrderId", clientOrderId);
+        query.addDecimal("stopPrice", stopPrice);
+        query.addString("stopPrice", stopPriceText);
+        query.addString("workingType", workingType);
+    }
+};
+
+struct OpenOrders {
+    static constexpr EndpointId id = EndpointId::OPEN_ORDERS;
+    std::string_view symbol;
+
+    int weight() const { return symbol.empty() ? 40 : 1; }
+    int orders() const { return 0; }
+    void encode(QueryWriter& query) const { query.addString("symbol", symbol); }
+};
+
+struct AllOrders {
+    static constexpr EndpointId id = EndpointId::ALL_ORDERS;
+    std::string_view symbol;
+    int limit;
+    std::optional<long long> orderId;
+    std::optional<long long> startTime;
+    std::optional<long long> endTime;
+
+    int weight() const { return 5; }
+    int orders() const { return 0; }
+    void encode(QueryWriter& query) const {
+        query.addString("symbol", symbol);
+        query.addInteger("limit", limit);
+        query.addInteger("orderId", orderId);
+        query.addInteger("startTime", startTime);
+        query.addInteger("endTime", endTime);
+    }
+};
+
+struct Account {
+    static constexpr EndpointId id = EndpointId::ACCOUNT;
+
+    int weight() const { return 5; }
+    int orders() const { return 0; }
+    void encode(QueryWriter&) const {}
+};
+
+struct PositionRisk {
+    static constexpr EndpointId id = EndpointId::POSITION_RISK;
+    std::string_view symbol;
+
+    int weight() const { return 5; }
+    int orders() const { return 0; }
+    void encode(QueryWriter& query) const { query.addString("symbol", symbol); }
+};
+
+struct FundingRate {
+    static constexpr EndpointId id = EndpointId::FUNDING_RATE;
+    std::string_view symbol;
+    int limit;
+
+    int weight() const { return 1; }
+    int orders() const { return 0; }
+    void encode(QueryWriter& query) const {
+        query.addString("symbol", symbol);
+        query.addInteger("limit", limit);
+    }
+};
+
+struct Income {
+    static constexpr EndpointId id = EndpointId::INCOME;
+    std::string_view symbol;
+    std::string_view incomeType;
+    std::optional<long long> startTime;
+    std::optional<long long> endTime;
+    int limit;
+
+    int weight() const { return 30; }
+    int orders() const { return 0; }
+    void encode(QueryWriter& query) const {
+        query.addString("symbol", symbol);
+        query.addString("incomeType", incomeType);
+        query.addInteger("startTime", startTime);
+        query.addInteger("endTime", endTime);
+        query.addInteger("limit", limit);
+    }
+};
+
+struct ExchangeInfo {
+    static constexpr EndpointId id = EndpointId::EXCHANGE_INFO;
+
+    int weight() const { return 1; }
+    int orders() const { return 0; }
+    void encode(QueryWriter&) const {}
+};
+
+struct LeverageBracket {
+    static constexpr EndpointId id = EndpointId::LEVERAGE_BRACKET;
+    std::string_view symbol;
+
+    int weight() const { return 1; }
+    int orders() const { return 0; }
+    void encode(QueryWriter& query) const { query.addString("symbol", symbol); }
+};
+
+}  // namespace endpoints
@@ -1,12 +1,25 @@
+#include "backtester.hpp"
 #include "binance_client.hpp"
+#include "endpoint_pinner.hpp"
+#include "exchange_info.hpp"
+#include "history_pager.hpp"
+#include "kline_aggregator.hpp"
+#include "multi_account_manager.hpp"
+#include "order_journal.hpp"
+#include "request_metrics.hpp"
+#include "risk_engine.hpp"
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstdlib>
 #include <exception>
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <optional>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -28,6 +41,8 @@ bool parse_bool(const std::string& value) {
 void print_usage() {
     std::cout << "Usage:\n"
               << "  call_api_test klines <PAIR> <INTERVAL> [LIMIT] [CONTRACT_TYPE]\n"
+              << "  call_api_test klines-derived <PAIR> <INTERVAL,...> [LIMIT] [CONTRACT_TYPE]\n"
+              << "      Fetches LIMIT 1m candles once and builds every listed interval from them locally.\n"
               << "  call_api_test set-leverage <SYMBOL> <LEVERAGE>\n"
               << "  call_api_test place-order <SYMBOL> <SIDE> <TYPE> [options]\n"
               << "      Options: --quantity <qty> --quoteQty <qty> --price <price> --timeInForce <GTC|IOC|FOK|GTX>\n"
@@ -35,12 +50,31 @@ void print_usage() {
               << "               --stopPrice <price> --stopLoss <price> --takeProfit <price>\n"
               << "  call_api_test open-orders [SYMBOL]\n"
               << "  call_api_test all-orders <SYMBOL> [LIMIT]\n"
+              << "  call_api_test order-history <SYMBOL> (--startTime <ms> | --fromId <orderId>) [--endTime <ms>] [--pageSize <n>]\n"
               << "  call_api_test account\n"
               << "  call_api_test position-risk [SYMBOL]\n"
               << "  call_api_test funding-rate <SYMBOL> [LIMIT]\n"
               << "  call_api_test funding-fee <SYMBOL> [LIMIT]\n"
+              << "  call_api_test income-history <SYMBOL> [--incomeType <TYPE>] [--startTime <ms>] [--endTime <ms>] [--pageSize <n>]\n"
               << "  call_api_test close-position <SYMBOL>\n"
-              << "  call_api_test status <SYMBOL>\n";
+              << "  call_api_test status <SYMBOL>\n"
+              << "  call_api_test risk [--mark <SYMBOL=PRICE,...>] [--marginRatio <ratio>] [--liqDistance <fraction>]\n"
+              << "      Seeds the local risk engine once, then replays the given mark prices as ticks.\n"
+              << "  call_api_test accounts-snapshot <ACCOUNTS_FILE> [SYMBOL]\n"
+              << "  call_api_test accounts-set-leverage <ACCOUNTS_FILE> <SYMBOL> <LEVERAGE>\n"
+              << "  call_api_test accounts-risk <ACCOUNTS_FILE> [risk options]\n"
+              << "      ACCOUNTS_FILE is a JSON array of {\"name\", \"apiKey\", \"secretKey\"} objects.\n"
+              << "  call_api_test backtest <KLINES_FILE> <SYMBOL> [--interval <1m>] [--fast <n>] [--slow <n>] [--quantity <qty>]\n"
+              << "               [--leverage <n>] [--balance <usdt>] [--fundingRate <rate>]\n"
+              << "  call_api_test backtest-sweep <KLINES_FILE> <SYMBOL> [--fast <n,n,...>] [--slow <n,n,...>] [--threads <n>] [backtest options]\n"
+              << "      KLINES_FILE is a klines JSON payload (.json) or CSV rows of openTime,open,high,low,close,volume.\n"
+              << "  call_api_test journal-dump <DIR>\n"
+              << "  call_api_test probe-endpoints [HOST] [PORT] [--address <IP>[,<IP>...]]\n"
+              << "  call_api_test exchange-info [SYMBOL...]\n"
+              << "\nSet BINANCE_JOURNAL_DIR to journal every signed request to an append-only log in that directory.\n"
+              << "Set BINANCE_METRICS=json|prometheus to print per-stage request latencies to stderr on exit.\n"
+              << "Set BINANCE_PIN_ENDPOINTS=1 to probe the API host's addresses and pin requests to the fastest ones.\n"
+              << "Set BINANCE_VALIDATE_ORDERS=1 to check orders against cached exchangeInfo rules and leverage brackets before sending them.\n";
 }
 
 BinanceFuturesClient::Side parse_side(const std::string& value) {
@@ -109,6 +143,36 @@ std::map<std::string, std::string> parse_options(int startIndex, int argc, char*
     return options;
 }
 
+BinanceFuturesClient::HistoryRange parse_history_range(const std::map<std::string, std::string>& options) {
+    BinanceFuturesClient::HistoryRange range;
+    if (auto it = options.find("startTime"); it != options.end()) {
+        range.startTime = std::stoll(it->second);
+    }
+    if (auto it = options.find("endTime"); it != options.end()) {
+        range.endTime = std::stoll(it->second);
+    }
+    if (auto it = options.find("fromId"); it != options.end()) {
+        range.fromId = std::stoll(it->second);
+    }
+    return range;
+}
+
+int parse_page_size(const std::map<std::string, std::string>& options) {
+    if (auto it = options.find("pageSize"); it != options.end()) {
+        return std::stoi(it->second);
+    }
+    return 1000;
+}
+
+void print_history(HistoryPager& pager) {
+    std::size_t count = 0;
+    pager.forEach([&count](const json& entry) {
+        std::cout << entry.dump() << '\n';
+        ++count;
+    });
+    std::cout << "Total entries: " << count << std::endl;
+}
+
 void print_json(const json& value) {
     std::cout << value.dump(2) << std::endl;
 }
@@ -122,17 +186,259 @@ bool read_use_testnet_from_env() {
     return !(value == "0" || value == "FALSE" || value == "NO" || value == "OFF");
 }
 
+std::string read_metrics_format_from_env() {
+    const char* env = std::getenv("BINANCE_METRICS");
+    return env ? to_upper(env) : std::string{};
+}
+
+std::shared_ptr<RequestMetrics> shared_metrics() {
+    static const std::shared_ptr<RequestMetrics> metrics =
+        read_metrics_format_from_env().empty() ? nullptr : std::make_shared<RequestMetrics>();
+    return metrics;
+}
+
+struct MetricsReport {
+    ~MetricsReport() {
+        auto metrics = shared_metrics();
+        if (!metrics) {
+            return;
+        }
+        if (read_metrics_format_from_env() == "PROMETHEUS") {
+            std::cerr << metrics->toPrometheus();
+        } else {
+            std::cerr << metrics->toJson().dump(2) << std::endl;
+        }
+    }
+};
+
+std::string api_host(bool useTestnet) {
+    return useTestnet ? "testnet.binancefuture.com" : "fapi.binance.com";
+}
+
+std::shared_ptr<EndpointPinner> shared_pinner() {
+    static const std::shared_ptr<EndpointPinner> pinner = [] {
+        const char* env = std::getenv("BINANCE_PIN_ENDPOINTS");
+        if (!env || !parse_bool(env)) {
+            return std::shared_ptr<EndpointPinner>();
+        }
+        EndpointPinner::Options options;
+        options.host = api_host(read_use_testnet_from_env());
+        auto created = std::make_shared<EndpointPinner>(options);
+        created->start();
+        return created;
+    }();
+    return pinner;
+}
+
 BinanceFuturesClient create_public_client() {
-    return BinanceFuturesClient("", "", read_use_testnet_from_env());
+    BinanceFuturesClient client("", "", read_use_testnet_from_env());
+    client.setMetrics(shared_metrics());
+    client.setEndpointPinner(shared_pinner());
+    return client;
+}
+
+std::shared_ptr<ExchangeInfoCache> shared_exchange_info() {
+    static const std::shared_ptr<ExchangeInfoCache> exchangeInfo = []() -> std::shared_ptr<ExchangeInfoCache> {
+        const char* env = std::getenv("BINANCE_VALIDATE_ORDERS");
+        if (!env || !parse_bool(env)) {
+            return nullptr;
+        }
+        // Constructed first, so it is destroyed after the cache's reload
+        // thread has stopped.
+        static BinanceFuturesClient loader = create_public_client();
+        auto created = std::make_shared<ExchangeInfoCache>();
+        created->start(loader);
+        return created;
+    }();
+    return exchangeInfo;
+}
+
+// One journal per process, so every client's entries share one sequence
+// and one set of segment files.
+std::shared_ptr<OrderJournal> shared_journal() {
+    static const std::shared_ptr<OrderJournal> journal = []() -> std::shared_ptr<OrderJournal> {
+        const char* journalDir = std::getenv("BINANCE_JOURNAL_DIR");
+        if (!journalDir || !*journalDir) {
+            return nullptr;
+        }
+        OrderJournal::Options options;
+        options.directory = journalDir;
+        return std::make_shared<OrderJournal>(options);
+    }();
+    return journal;
 }
 
 BinanceFuturesClient create_private_client(const char* apiKey, const char* apiSecret) {
-    return BinanceFuturesClient(apiKey ? apiKey : "", apiSecret ? apiSecret : "", read_use_testnet_from_env());
+    BinanceFuturesClient client(apiKey ? apiKey : "", apiSecret ? apiSecret : "", read_use_testnet_from_env());
+    client.setMetrics(shared_metrics());
+    client.setEndpointPinner(shared_pinner());
+    client.setExchangeInfo(shared_exchange_info());
+    client.setJournal(shared_journal());
+    return client;
+}
+
+std::unique_ptr<MultiAccountManager> create_account_manager(const std::string& path) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("Unable to open accounts file: " + path);
+    }
+    const json accounts = json::parse(input);
+    if (!accounts.is_array()) {
+        throw std::runtime_error("Accounts file must contain a JSON array");
+    }
+
+    MultiAccountManager::Options options;
+    options.useTestnet = read_use_testnet_from_env();
+    options.pinner = shared_pinner();
+    options.exchangeInfo = shared_exchange_info();
+    options.metrics = shared_metrics();
+    options.journal = shared_journal();
+    auto manager = std::make_unique<MultiAccountManager>(options);
+    for (const auto& entry : accounts) {
+        manager->addAccount({entry.at("name").get<std::string>(),
+                             entry.at("apiKey").get<std::string>(),
+                             entry.at("secretKey").get<std::string>()});
+    }
+    return manager;
+}
+
+std::string option_or(const std::map<std::string, std::string>& options, const std::string& key, const std::string& fallback) {
+    auto it = options.find(key);
+    return it != options.end() ? it->second : fallback;
+}
+
+std::vector<std::string> split_list(const std::string& value) {
+    std::vector<std::string> result;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            result.push_back(item);
+        }
+    }
+    return result;
+}
+
+std::vector<int> parse_int_list(const std::string& value) {
+    std::vector<int> result;
+    for (const auto& item : split_list(value)) {
+        result.push_back(std::stoi(item));
+    }
+    return result;
+}
+
+// Demo strategy: always in the market, long while the fast close average is
+// above the slow one and short otherwise.
+Backtester::Strategy make_sma_cross(const std::string& symbol, int fast, int slow, double quantity) {
+    if (fast <= 0 || slow <= fast) {
+        throw std::runtime_error("SMA periods must satisfy 0 < fast < slow");
+    }
+    struct State {
+        double fastSum = 0.0;
+        double slowSum = 0.0;
+        int direction = 0;
+    };
+    auto state = std::make_shared<State>();
+    const auto fastPeriod = static_cast<std::size_t>(fast);
+    const auto slowPeriod = static_cast<std::size_t>(slow);
+
+    return [=](SimulatedExchange& exchange) {
+        const KlineSeries& klines = exchange.klines(symbol);
+        const std::size_t i = exchange.barIndex(symbol);
+        state->fastSum += klines.close[i];
+        state->slowSum += klines.close[i];
+        if (i >= fastPeriod) {
+            state->fastSum -= klines.close[i - fastPeriod];
+        }
+        if (i >= slowPeriod) {
+            state->slowSum -= klines.close[i - slowPeriod];
+        }
+        if (i + 1 < slowPeriod) {
+            return;
+        }
+
+        const int wanted = state->fastSum / fastPeriod > state->slowSum / slowPeriod ? 1 : -1;
+        if (wanted == state->direction) {
+            return;
+        }
+        exchange.closePosition(symbol);
+        state->direction = wanted;
+
+        BinanceFuturesClient::OrderRequest request;
+        request.symbol = symbol;
+        request.side = wanted > 0 ? BinanceFuturesClient::Side::BUY : BinanceFuturesClient::Side::SELL;
+        request.type = BinanceFuturesClient::OrderType::MARKET;
+        request.quantity = quantity;
+        try {
+            exchange.placeOrder(request);
+        } catch (const std::exception&) {
+            // Rejected (usually margin); stay flat until the next crossover.
+        }
+    };
+}
+
+json run_sma_backtest(const std::shared_ptr<const KlineSeries>& klines,
+                      const std::string& symbol,
+                      const std::map<std::string, std::string>& options,
+                      int fast,
+                      int slow) {
+    SimulatedExchange::Options exchangeOptions;
+    exchangeOptions.initialBalance = std::stod(option_or(options, "balance", "10000"));
+    exchangeOptions.defaultFundingRate = std::stod(option_or(options, "fundingRate", "0.0001"));
+    SimulatedExchange exchange(exchangeOptions);
+    exchange.addSymbol(symbol, klines);
+    exchange.setLeverage(symbol, std::stoi(option_or(options, "leverage", "10")));
+    const double quantity = std::stod(option_or(options, "quantity", "1"));
+    return Backtester::run(exchange, make_sma_cross(symbol, fast, slow, quantity));
+}
+
+json run_risk(RiskEngine& engine, const std::map<std::string, std::string>& options) {
+    json alerts = json::array();
+    auto report = [&engine, &alerts](const RiskEngine::Alert& alert) {
+        alerts.push_back({
+            {"kind", alert.kind == RiskEngine::AlertKind::MARGIN_RATIO ? "MARGIN_RATIO" : "LIQUIDATION_DISTANCE"},
+            {"account", engine.accountName(alert.account)},
+            {"symbol", engine.symbolName(alert.symbol)},
+            {"value", alert.value},
+            {"threshold", alert.threshold},
+            {"latencyNs", alert.latencyNs}
+        });
+    };
+    if (auto it = options.find("marginRatio"); it != options.end()) {
+        engine.onMarginRatio(std::stod(it->second), report);
+    }
+    if (auto it = options.find("liqDistance"); it != options.end()) {
+        engine.onLiquidationDistance(std::stod(it->second), report);
+    }
+
+    if (auto it = options.find("mark"); it != options.end()) {
+        std::stringstream stream(it->second);
+        std::string tick;
+        while (std::getline(stream, tick, ',')) {
+            const auto separator = tick.find('=');
+            if (separator == std::string::npos) {
+                throw std::runtime_error("Invalid --mark entry: " + tick);
+            }
+            engine.onMarkPrice(to_upper(tick.substr(0, separator)), std::stod(tick.substr(separator + 1)));
+        }
+    }
+    return json{{"accounts", engine.toJson()}, {"alerts", alerts}};
+}
+
+void dump_journal(const std::string& directory) {
+    JournalReader reader(directory);
+    std::size_t count = 0;
+    reader.replay([&count](const JournalEntry& entry) {
+        std::cout << JournalReader::toJson(entry).dump(-1, ' ', false, json::error_handler_t::replace) << '\n';
+        ++count;
+    });
+    std::cout << "Total records: " << count << std::endl;
 }
 
 }  // namespace
 
 int call_api_demo(int argc, char* argv[]) {
+    MetricsReport metricsReport;
     try {
         if (argc == 1) {
             print_usage();
@@ -177,6 +483,139 @@ int call_api_demo(int argc, char* argv[]) {
             print_json(data);
             return 0;
         }
+        if (command == "klines-derived") {
+            if (argc < 4) {
+                throw std::runtime_error("klines-derived requires <PAIR> and <INTERVAL,...>");
+            }
+            const std::string pair = argv[2];
+            const std::vector<std::string> intervals = split_list(argv[3]);
+            const int limit = argc >= 5 ? std::stoi(argv[4]) : 1500;
+            const std::string contractType = argc >= 6 ? argv[5] : "PERPETUAL";
+            BinanceFuturesClient publicClient = create_public_client();
+            KlineSeries minutes("1m");
+            minutes.appendJson(publicClient.getContinuousKlines(pair, "1m", limit, contractType));
+            json result = json::object();
+            for (const auto& interval : intervals) {
+                const KlineSeries derived = KlineAggregator::aggregate(minutes, interval);
+                result[interval] = derived.toJson(0, derived.size());
+            }
+            print_json(result);
+            return 0;
+        }
+
+        if (command == "accounts-snapshot") {
+            if (argc < 3) {
+                throw std::runtime_error("accounts-snapshot requires <ACCOUNTS_FILE>");
+            }
+            std::string symbol;
+            if (argc >= 4) {
+                symbol = argv[3];
+            }
+            auto manager = create_account_manager(argv[2]);
+            print_json(manager->snapshotAll(symbol));
+            return 0;
+        }
+        if (command == "accounts-set-leverage") {
+            if (argc < 5) {
+                throw std::runtime_error("accounts-set-leverage requires <ACCOUNTS_FILE> <SYMBOL> <LEVERAGE>");
+            }
+            auto manager = create_account_manager(argv[2]);
+            print_json(manager->setLeverageAll(argv[3], std::stoi(argv[4])));
+            return 0;
+        }
+        if (command == "accounts-risk") {
+            if (argc < 3) {
+                throw std::runtime_error("accounts-risk requires <ACCOUNTS_FILE>");
+            }
+            auto options = parse_options(3, argc, argv);
+            auto manager = create_account_manager(argv[2]);
+            const json snapshot = manager->snapshotAll();
+            RiskEngine engine;
+            for (const auto& [name, entry] : snapshot.items()) {
+                if (entry["account"].contains("error") || entry["positions"].contains("error")) {
+                    std::cerr << "Skipping " << name << ": snapshot failed" << std::endl;
+                    continue;
+                }
+                engine.seed(engine.addAccount(name), entry["account"], entry["positions"]);
+            }
+            print_json(run_risk(engine, options));
+            return 0;
+        }
+        if (command == "backtest" || command == "backtest-sweep") {
+            if (argc < 4) {
+                throw std::runtime_error(command + " requires <KLINES_FILE> <SYMBOL>");
+            }
+            const std::string symbol = to_upper(argv[3]);
+            auto options = parse_options(4, argc, argv);
+            const auto loadStart = std::chrono::steady_clock::now();
+            auto klines = std::make_shared<const KlineSeries>(KlineSeries::loadFile(argv[2], option_or(options, "interval", "1m")));
+            const auto runStart = std::chrono::steady_clock::now();
+
+            json output;
+            if (command == "backtest") {
+                output = run_sma_backtest(klines, symbol, options,
+                                          std::stoi(option_or(options, "fast", "20")),
+                                          std::stoi(option_or(options, "slow", "50")));
+            } else {
+                std::vector<json> parameterSets;
+                for (int fast : parse_int_list(option_or(options, "fast", "5,10,20,50"))) {
+                    for (int slow : parse_int_list(option_or(options, "slow", "50,100,200,400"))) {
+                        if (fast < slow) {
+                            parameterSets.push_back({{"fast", fast}, {"slow", slow}});
+                        }
+                    }
+                }
+                auto results = Backtester::sweep(parameterSets, [&](const json& parameters) {
+                    return run_sma_backtest(klines, symbol, options, parameters.at("fast").get<int>(), parameters.at("slow").get<int>());
+                }, static_cast<unsigned>(std::stoul(option_or(options, "threads", "0"))));
+                output["results"] = results;
+            }
+
+            const auto end = std::chrono::steady_clock::now();
+            output["bars"] = klines->size();
+            output["loadMs"] = std::chrono::duration_cast<std::chrono::milliseconds>(runStart - loadStart).count();
+            output["runMs"] = std::chrono::duration_cast<std::chrono::milliseconds>(end - runStart).count();
+            print_json(output);
+            return 0;
+        }
+        if (command == "journal-dump") {
+            if (argc < 3) {
+                throw std::runtime_error("journal-dump requires <DIR>");
+            }
+            dump_journal(argv[2]);
+            return 0;
+        }
+        if (command == "exchange-info") {
+            BinanceFuturesClient publicClient = create_public_client();
+            ExchangeInfoCache cache;
+            cache.refresh(publicClient);
+            json result = json::object();
+            result["symbols"] = cache.size();
+            for (int i = 2; i < argc; ++i) {
+                const std::string symbol = to_upper(argv[i]);
+                auto rules = cache.rules(symbol);
+                result[symbol] = rules ? ExchangeInfoCache::toJson(*rules) : json("unknown symbol");
+            }
+            print_json(result);
+            return 0;
+        }
+        if (command == "probe-endpoints") {
+            EndpointPinner::Options options;
+            int next = 2;
+            auto positional = [&] { return next < argc && std::string(argv[next]).rfind("--", 0) != 0; };
+            options.host = positional() ? argv[next++] : api_host(read_use_testnet_from_env());
+            if (positional()) {
+                options.port = std::stoi(argv[next++]);
+            }
+            const auto flags = parse_options(next, argc, argv);
+            if (auto it = flags.find("address"); it != flags.end()) {
+                options.addresses = split_list(it->second);
+            }
+            EndpointPinner pinner(options);
+            pinner.probeNow();
+            print_json(pinner.toJson());
+            return 0;
+        }
 
         const char* apiKey = std::getenv("BINANCE_API_KEY");
         const char* apiSecret = std::getenv("BINANCE_API_SECRET");
@@ -237,6 +676,12 @@ int call_api_demo(int argc, char* argv[]) {
                 request.takeProfitPrice = std::stod(it->second);
             }
 
+            if (auto exchangeInfo = shared_exchange_info()) {
+                // Brackets and leverage are this account's own; fetch them
+                // ahead of the order so its checks need no round trip.
+                exchangeInfo->refreshLeverageBrackets(client);
+                client.getPositionRisk(request.symbol);
+            }
             auto response = client.placeOrder(request);
             print_json(response);
             return 0;
@@ -263,6 +708,16 @@ int call_api_demo(int argc, char* argv[]) {
             print_json(response);
             return 0;
         }
+        if (command == "order-history") {
+            if (argc < 3) {
+                throw std::runtime_error("order-history requires <SYMBOL>");
+            }
+            const std::string symbol = argv[2];
+            auto options = parse_options(3, argc, argv);
+            auto pager = HistoryPager::allOrders(client, symbol, parse_history_range(options), parse_page_size(options));
+            print_history(pager);
+            return 0;
+        }
         if (command == "account") {
             auto response = client.getAccountInfo();
             print_json(response);
@@ -303,6 +758,20 @@ int call_api_demo(int argc, char* argv[]) {
             print_json(response);
             return 0;
         }
+        if (command == "income-history") {
+            if (argc < 3) {
+                throw std::runtime_error("income-history requires <SYMBOL>");
+            }
+            const std::string symbol = argv[2];
+            auto options = parse_options(3, argc, argv);
+            std::string incomeType;
+            if (auto it = options.find("incomeType"); it != options.end()) {
+                incomeType = it->second;
+            }
+            auto pager = HistoryPager::income(client, symbol, incomeType, parse_history_range(options), parse_page_size(options));
+            print_history(pager);
+            return 0;
+        }
         if (command == "close-position") {
             if (argc < 3) {
                 throw std::runtime_error("close-position requires <SYMBOL>");
@@ -327,6 +796,14 @@ int call_api_demo(int argc, char* argv[]) {
             return 0;
         }
 
+        if (command == "risk") {
+            auto options = parse_options(2, argc, argv);
+            RiskEngine engine;
+            engine.seedFrom(engine.addAccount("default"), client);
+            print_json(run_risk(engine, options));
+            return 0;
+        }
+
         throw std::runtime_error("Unknown command: " + command);
     }
     catch (const std::exception& e) {
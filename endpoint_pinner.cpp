@@ -0,0 +1,360 @@
+#include "endpoint_pinner.hpp"
+
+#include <arpa/inet.h>
+#include <curl/curl.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <openssl/ssl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double elapsed_us(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::micro>(to - from).count();
+}
+
+class SocketGuard {
+public:
+    explicit SocketGuard(int fd) : fd_(fd) {}
+    ~SocketGuard() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    SocketGuard(const SocketGuard&) = delete;
+    SocketGuard& operator=(const SocketGuard&) = delete;
+
+    int get() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+SSL_CTX* probe_ssl_context() {
+    // Certificates are not verified, matching the client's own settings;
+    // only the handshake time matters here.
+    static SSL_CTX* context = [] {
+        SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+        if (ctx) {
+            SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+        }
+        return ctx;
+    }();
+    return context;
+}
+
+bool tls_handshake(int fd, const std::string& host, std::chrono::milliseconds timeout) {
+    SSL_CTX* context = probe_ssl_context();
+    if (!context) {
+        return false;
+    }
+
+    const int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    SSL* ssl = SSL_new(context);
+    if (!ssl) {
+        return false;
+    }
+    SSL_set_fd(ssl, fd);
+    SSL_set_tlsext_host_name(ssl, host.c_str());
+    const bool ok = SSL_connect(ssl) == 1;
+    SSL_free(ssl);
+    return ok;
+}
+
+std::string resolve_entry(const std::string& host, int port, const std::vector<std::string>& addresses) {
+    std::string entry = host + ":" + std::to_string(port) + ":";
+    for (std::size_t i = 0; i < addresses.size(); ++i) {
+        if (i > 0) {
+            entry.push_back(',');
+        }
+        const bool ipv6 = addresses[i].find(':') != std::string::npos;
+        entry += ipv6 ? "[" + addresses[i] + "]" : addresses[i];
+    }
+    return entry;
+}
+}  // namespace
+
+struct EndpointPinner::ResolveList {
+    explicit ResolveList(const std::string& entry)
+        : list(curl_slist_append(nullptr, entry.c_str())) {
+        if (!list) {
+            throw std::runtime_error("Failed to build curl resolve list");
+        }
+    }
+    ~ResolveList() {
+        curl_slist_free_all(list);
+    }
+    ResolveList(const ResolveList&) = delete;
+    ResolveList& operator=(const ResolveList&) = delete;
+
+    curl_slist* list;
+};
+
+EndpointPinner::EndpointPinner(Options options, Probe probe)
+    : options_(std::move(options)),
+      probe_(probe ? std::move(probe) : Probe(&EndpointPinner::connectProbe)) {
+    if (options_.host.empty()) {
+        throw std::runtime_error("EndpointPinner requires a host");
+    }
+}
+
+EndpointPinner::~EndpointPinner() {
+    stop();
+}
+
+std::optional<EndpointPinner::Timing> EndpointPinner::connectProbe(const std::string& address, const Options& options) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(address.c_str(), std::to_string(options.port).c_str(), &hints, &result) != 0 || !result) {
+        return std::nullopt;
+    }
+    std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> info(result, &freeaddrinfo);
+
+    SocketGuard socket(::socket(info->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0));
+    if (socket.get() < 0) {
+        return std::nullopt;
+    }
+
+    const auto started = Clock::now();
+    if (::connect(socket.get(), info->ai_addr, info->ai_addrlen) != 0) {
+        if (errno != EINPROGRESS) {
+            return std::nullopt;
+        }
+        pollfd pfd{socket.get(), POLLOUT, 0};
+        if (poll(&pfd, 1, static_cast<int>(options.timeout.count())) != 1) {
+            return std::nullopt;
+        }
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(socket.get(), SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+            return std::nullopt;
+        }
+    }
+    const auto connected = Clock::now();
+
+    Timing timing;
+    timing.connectUs = elapsed_us(started, connected);
+    if (options.tls) {
+        if (!tls_handshake(socket.get(), options.host, options.timeout)) {
+            return std::nullopt;
+        }
+        timing.tlsUs = elapsed_us(connected, Clock::now());
+    }
+    return timing;
+}
+
+std::vector<std::string> EndpointPinner::resolve() const {
+    if (!options_.addresses.empty()) {
+        return options_.addresses;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(options_.host.c_str(), nullptr, &hints, &result) != 0) {
+        return {};
+    }
+    std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> info(result, &freeaddrinfo);
+
+    std::vector<std::string> addresses;
+    for (addrinfo* entry = result; entry; entry = entry->ai_next) {
+        char buffer[INET6_ADDRSTRLEN] = {};
+        const void* raw = entry->ai_family == AF_INET6
+                              ? static_cast<const void*>(&reinterpret_cast<sockaddr_in6*>(entry->ai_addr)->sin6_addr)
+                              : static_cast<const void*>(&reinterpret_cast<sockaddr_in*>(entry->ai_addr)->sin_addr);
+        if (inet_ntop(entry->ai_family, raw, buffer, sizeof(buffer))) {
+            std::string address = buffer;
+            if (std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+                addresses.push_back(std::move(address));
+            }
+        }
+    }
+    return addresses;
+}
+
+void EndpointPinner::probeNow() {
+    const std::vector<std::string> addresses = resolve();
+
+    std::vector<std::future<Measurement>> pending;
+    pending.reserve(addresses.size());
+    for (const auto& address : addresses) {
+        pending.push_back(std::async(std::launch::async, [this, address] {
+            std::vector<Timing> timings;
+            for (std::size_t i = 0; i < std::max<std::size_t>(options_.samples, 1); ++i) {
+                if (auto timing = probe_(address, options_)) {
+                    timings.push_back(*timing);
+                }
+            }
+
+            Measurement measurement;
+            measurement.address = address;
+            measurement.failures = static_cast<std::uint32_t>(std::max<std::size_t>(options_.samples, 1) - timings.size());
+            measurement.healthy = !timings.empty() && timings.size() * 2 >= std::max<std::size_t>(options_.samples, 1);
+            if (!timings.empty()) {
+                std::sort(timings.begin(), timings.end(), [](const Timing& a, const Timing& b) {
+                    return a.connectUs + a.tlsUs < b.connectUs + b.tlsUs;
+                });
+                const Timing& median = timings[timings.size() / 2];
+                measurement.connectUs = median.connectUs;
+                measurement.tlsUs = median.tlsUs;
+                measurement.scoreUs = median.connectUs + median.tlsUs;
+            }
+            return measurement;
+        }));
+    }
+
+    std::vector<Measurement> results;
+    results.reserve(pending.size());
+    for (auto& future : pending) {
+        results.push_back(future.get());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    measurements_ = std::move(results);
+    rank();
+}
+
+void EndpointPinner::rank() {
+    std::sort(measurements_.begin(), measurements_.end(), [](const Measurement& a, const Measurement& b) {
+        if (a.healthy != b.healthy) {
+            return a.healthy;
+        }
+        return a.scoreUs < b.scoreUs;
+    });
+
+    std::vector<std::string> next;
+    if (!pinned_.empty()) {
+        auto primary = std::find_if(measurements_.begin(), measurements_.end(),
+                                    [&](const Measurement& m) { return m.address == pinned_.front(); });
+        if (primary != measurements_.end() && primary->healthy && !measurements_.empty() &&
+            primary->scoreUs <= measurements_.front().scoreUs * options_.degradeFactor) {
+            next.push_back(primary->address);
+        }
+    }
+    for (const auto& measurement : measurements_) {
+        if (next.size() >= std::max<std::size_t>(options_.pinCount, 1)) {
+            break;
+        }
+        if (measurement.healthy && std::find(next.begin(), next.end(), measurement.address) == next.end()) {
+            next.push_back(measurement.address);
+        }
+    }
+
+    pinned_ = std::move(next);
+    if (!pinned_.empty()) {
+        resolveList_ = std::make_shared<const ResolveList>(resolve_entry(options_.host, options_.port, pinned_));
+    } else if (resolveList_) {
+        // Resolve overrides never expire from a shared DNS cache, so an
+        // earlier pin has to be removed explicitly to fall back to DNS.
+        resolveList_ = std::make_shared<const ResolveList>("-" + options_.host + ":" + std::to_string(options_.port));
+    }
+}
+
+std::shared_ptr<const void> EndpointPinner::apply(void* curlHandle) const {
+    std::shared_ptr<const ResolveList> list;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        list = resolveList_;
+    }
+    if (list) {
+        curl_easy_setopt(static_cast<CURL*>(curlHandle), CURLOPT_RESOLVE, list->list);
+    }
+    return list;
+}
+
+void EndpointPinner::reportFailure(const std::string& address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(measurements_.begin(), measurements_.end(), [&](const Measurement& m) { return m.address == address; });
+    if (it == measurements_.end()) {
+        return;
+    }
+    it->healthy = false;
+    ++it->failures;
+    rank();
+}
+
+void EndpointPinner::start() {
+    {
+        std::lock_guard<std::mutex> lock(runMutex_);
+        if (running_) {
+            return;
+        }
+        running_ = true;
+    }
+    probeNow();
+    thread_ = std::thread([this] {
+        std::unique_lock<std::mutex> lock(runMutex_);
+        while (!wake_.wait_for(lock, options_.reprobeInterval, [this] { return !running_; })) {
+            lock.unlock();
+            probeNow();
+            lock.lock();
+        }
+    });
+}
+
+void EndpointPinner::stop() {
+    {
+        std::lock_guard<std::mutex> lock(runMutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::vector<std::string> EndpointPinner::pinned() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pinned_;
+}
+
+std::vector<EndpointPinner::Measurement> EndpointPinner::measurements() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return measurements_;
+}
+
+json EndpointPinner::toJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json addresses = json::array();
+    for (const auto& m : measurements_) {
+        addresses.push_back({
+            {"address", m.address},
+            {"healthy", m.healthy},
+            {"connectUs", m.connectUs},
+            {"tlsUs", m.tlsUs},
+            {"scoreUs", m.scoreUs},
+            {"failures", m.failures}
+        });
+    }
+    return json{
+        {"host", options_.host},
+        {"port", options_.port},
+        {"pinned", pinned_},
+        {"addresses", addresses}
+    };
+}
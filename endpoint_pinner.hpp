@@ -0,0 +1,101 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures connect and TLS handshake time to every address a host resolves
+// to and pins curl to the fastest healthy ones through CURLOPT_RESOLVE.
+class EndpointPinner {
+public:
+    struct Options {
+        std::string host;
+        int port = 443;
+        bool tls = true;
+        std::chrono::milliseconds timeout{1000};
+        std::chrono::seconds reprobeInterval{60};
+        std::size_t samples = 3;
+        std::size_t pinCount = 2;
+        // The pinned primary is only replaced once its score is this many
+        // times worse than the best candidate, so pooled connections are not
+        // churned over noise.
+        double degradeFactor = 1.5;
+        // Skips DNS and probes exactly these addresses, e.g. local stand-ins.
+        std::vector<std::string> addresses;
+    };
+
+    struct Timing {
+        double connectUs = 0.0;
+        double tlsUs = 0.0;
+    };
+
+    // Measures one connection to `address`; nullopt when it fails. The
+    // default probe opens a real TCP (and optionally TLS) connection.
+    using Probe = std::function<std::optional<Timing>(const std::string& address, const Options& options)>;
+
+    struct Measurement {
+        std::string address;
+        bool healthy = false;
+        double connectUs = 0.0;
+        double tlsUs = 0.0;
+        double scoreUs = 0.0;
+        std::uint32_t failures = 0;
+    };
+
+    explicit EndpointPinner(Options options, Probe probe = {});
+    ~EndpointPinner();
+
+    EndpointPinner(const EndpointPinner&) = delete;
+    EndpointPinner& operator=(const EndpointPinner&) = delete;
+
+    // Resolves the host, probes every address and re-ranks the pins.
+    void probeNow();
+
+    // Probes once before returning, then re-probes every reprobeInterval on
+    // a background thread.
+    void start();
+    void stop();
+
+    // Installs the current pins on a curl handle. The returned token owns the
+    // resolve list and must outlive the transfer; null when nothing was ever
+    // pinned.
+    std::shared_ptr<const void> apply(void* curlHandle) const;
+
+    // Marks an address unhealthy until the next probe and fails over at once.
+    void reportFailure(const std::string& address);
+
+    std::vector<std::string> pinned() const;
+    std::vector<Measurement> measurements() const;
+    nlohmann::json toJson() const;
+
+    static std::optional<Timing> connectProbe(const std::string& address, const Options& options);
+
+private:
+    struct ResolveList;
+
+    std::vector<std::string> resolve() const;
+    void rank();
+
+    Options options_;
+    Probe probe_;
+
+    mutable std::mutex mutex_;
+    std::vector<Measurement> measurements_;
+    std::vector<std::string> pinned_;
+    std::shared_ptr<const ResolveList> resolveList_;
+
+    std::mutex runMutex_;
+    std::condition_variable wake_;
+    bool running_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,559 @@
+#include "exchange_info.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+constexpr int kMaxDecimals = 16;
+
+// Digits after the decimal point once trailing zeros are dropped, so
+// "0.00100000" gives 3.
+int decimals_of(const std::string& text) {
+    const auto dot = text.find('.');
+    if (dot == std::string::npos) {
+        return 0;
+    }
+    const auto last = text.find_last_not_of('0');
+    return last == std::string::npos || last <= dot ? 0 : static_cast<int>(last - dot);
+}
+
+// Parses decimal text into units of 10^-decimals without going through
+// floating point. Digits beyond `decimals` are dropped.
+std::int64_t parse_units(const std::string& text, int decimals) {
+    std::int64_t units = 0;
+    int fraction = -1;
+    bool negative = false;
+    for (char c : text) {
+        if (c == '-') {
+            negative = true;
+        } else if (c == '.') {
+            fraction = 0;
+        } else if (c >= '0' && c <= '9') {
+            if (fraction >= decimals) {
+                continue;
+            }
+            units = units * 10 + (c - '0');
+            if (fraction >= 0) {
+                ++fraction;
+            }
+        }
+    }
+    for (int i = fraction < 0 ? 0 : fraction; i < decimals; ++i) {
+        units *= 10;
+    }
+    return negative ? -units : units;
+}
+
+// Converts a value to integer units; false when it has more precision than
+// the scale holds. The tolerance only absorbs binary rounding of decimal
+// inputs such as 0.1 + 0.2.
+bool to_units(double value, double scale, std::int64_t& units) {
+    const double scaled = value * scale;
+    const double rounded = std::nearbyint(scaled);
+    if (std::fabs(scaled - rounded) > 1e-9 + std::fabs(scaled) * 1e-12 || std::fabs(rounded) > 9e18) {
+        return false;
+    }
+    units = static_cast<std::int64_t>(rounded);
+    return true;
+}
+
+std::string format_units(std::int64_t units, int decimals) {
+    char digits[24];
+    const bool negative = units < 0;
+    const auto end = std::to_chars(digits, digits + sizeof(digits), negative ? -units : units).ptr;
+    const int length = static_cast<int>(end - digits);
+
+    std::string text;
+    text.reserve(static_cast<std::size_t>(length + decimals + 3));
+    if (negative) {
+        text.push_back('-');
+    }
+    if (length <= decimals) {
+        text += "0.";
+        text.append(static_cast<std::size_t>(decimals - length), '0');
+        text.append(digits, end);
+        return text;
+    }
+    text.append(digits, digits + (length - decimals));
+    if (decimals > 0) {
+        text.push_back('.');
+        text.append(digits + (length - decimals), end);
+    }
+    return text;
+}
+
+const json* find_filter(const json& symbol, const char* type) {
+    auto filters = symbol.find("filters");
+    if (filters == symbol.end() || !filters->is_array()) {
+        return nullptr;
+    }
+    for (const auto& filter : *filters) {
+        if (filter.value("filterType", "") == type) {
+            return &filter;
+        }
+    }
+    return nullptr;
+}
+
+std::string text_field(const json& object, const char* key) {
+    auto it = object.find(key);
+    if (it == object.end() || it->is_null()) {
+        return "0";
+    }
+    return it->is_string() ? it->get<std::string>() : it->dump();
+}
+
+double number_field(const json& object, const char* key) {
+    const auto& value = object.at(key);
+    return value.is_string() ? std::stod(value.get<std::string>()) : value.get<double>();
+}
+
+double scale_for(int decimals) {
+    return std::pow(10.0, decimals);
+}
+
+ExchangeInfoCache::SymbolRules parse_rules(const json& entry) {
+    ExchangeInfoCache::SymbolRules rules;
+    rules.symbol = entry.at("symbol").get<std::string>();
+    rules.trading = entry.value("status", "") == "TRADING";
+
+    const json* price = find_filter(entry, "PRICE_FILTER");
+    const json* lot = find_filter(entry, "LOT_SIZE");
+    const json* marketLot = find_filter(entry, "MARKET_LOT_SIZE");
+    const json* notional = find_filter(entry, "MIN_NOTIONAL");
+
+    // The filters' increments define the real precision; pricePrecision and
+    // quantityPrecision are only used when a filter is missing.
+    int priceDecimals = entry.value("pricePrecision", 0);
+    if (price) {
+        priceDecimals = decimals_of(text_field(*price, "tickSize"));
+    }
+    int quantityDecimals = entry.value("quantityPrecision", 0);
+    if (lot) {
+        quantityDecimals = decimals_of(text_field(*lot, "stepSize"));
+    }
+    if (marketLot) {
+        quantityDecimals = std::max(quantityDecimals, decimals_of(text_field(*marketLot, "stepSize")));
+    }
+    if (priceDecimals > kMaxDecimals || quantityDecimals > kMaxDecimals) {
+        throw std::runtime_error("Unsupported precision for " + rules.symbol);
+    }
+    rules.priceDecimals = static_cast<std::uint8_t>(priceDecimals);
+    rules.quantityDecimals = static_cast<std::uint8_t>(quantityDecimals);
+    rules.priceScale = scale_for(priceDecimals);
+    rules.quantityScale = scale_for(quantityDecimals);
+
+    if (price) {
+        rules.tickSize = parse_units(text_field(*price, "tickSize"), priceDecimals);
+        rules.minPrice = parse_units(text_field(*price, "minPrice"), priceDecimals);
+        rules.maxPrice = parse_units(text_field(*price, "maxPrice"), priceDecimals);
+    }
+    if (lot) {
+        rules.stepSize = parse_units(text_field(*lot, "stepSize"), quantityDecimals);
+        rules.minQty = parse_units(text_field(*lot, "minQty"), quantityDecimals);
+        rules.maxQty = parse_units(text_field(*lot, "maxQty"), quantityDecimals);
+    }
+    if (marketLot) {
+        rules.marketStepSize = parse_units(text_field(*marketLot, "stepSize"), quantityDecimals);
+        rules.marketMinQty = parse_units(text_field(*marketLot, "minQty"), quantityDecimals);
+        rules.marketMaxQty = parse_units(text_field(*marketLot, "maxQty"), quantityDecimals);
+    } else {
+        rules.marketStepSize = rules.stepSize;
+        rules.marketMinQty = rules.minQty;
+        rules.marketMaxQty = rules.maxQty;
+    }
+    rules.tickSize = std::max<std::int64_t>(rules.tickSize, 1);
+    rules.stepSize = std::max<std::int64_t>(rules.stepSize, 1);
+    rules.marketStepSize = std::max<std::int64_t>(rules.marketStepSize, 1);
+    if (notional) {
+        rules.minNotional = std::stod(text_field(*notional, "notional"));
+    }
+    return rules;
+}
+
+ExchangeInfoCache::Verdict check_price(const ExchangeInfoCache::SymbolRules& rules, double price) {
+    using Verdict = ExchangeInfoCache::Verdict;
+    std::int64_t units = 0;
+    if (!to_units(price, rules.priceScale, units)) {
+        return Verdict::PRICE_PRECISION;
+    }
+    if (units % rules.tickSize != 0) {
+        return Verdict::PRICE_TICK;
+    }
+    if (units < rules.minPrice || units <= 0) {
+        return Verdict::PRICE_TOO_LOW;
+    }
+    if (rules.maxPrice > 0 && units > rules.maxPrice) {
+        return Verdict::PRICE_TOO_HIGH;
+    }
+    return Verdict::OK;
+}
+}  // namespace
+
+ExchangeInfoCache::ExchangeInfoCache()
+    : ExchangeInfoCache(Options{}) {
+}
+
+ExchangeInfoCache::ExchangeInfoCache(Options options)
+    : options_(options) {
+}
+
+ExchangeInfoCache::~ExchangeInfoCache() {
+    stop();
+}
+
+void ExchangeInfoCache::load(const json& exchangeInfo) {
+    auto symbols = exchangeInfo.find("symbols");
+    if (symbols == exchangeInfo.end() || !symbols->is_array()) {
+        throw std::runtime_error("exchangeInfo payload has no symbols");
+    }
+
+    std::lock_guard<std::mutex> write(writeMutex_);
+    auto next = std::make_shared<Snapshot>();
+    // Keep every id handed out so far; symbols that disappeared stay known
+    // but stop trading.
+    if (auto previous = snapshot()) {
+        next->ids = previous->ids;
+        next->rules = previous->rules;
+        for (auto& rules : next->rules) {
+            rules.trading = false;
+        }
+    }
+    for (const auto& entry : *symbols) {
+        SymbolRules rules = parse_rules(entry);
+        auto [it, inserted] = next->ids.emplace(rules.symbol, static_cast<SymbolId>(next->rules.size()));
+        if (inserted) {
+            next->rules.push_back(std::move(rules));
+        } else {
+            rules.brackets = std::move(next->rules[it->second].brackets);
+            next->rules[it->second] = std::move(rules);
+        }
+    }
+    next->loadedAt = std::chrono::steady_clock::now();
+    publish(std::move(next));
+}
+
+void ExchangeInfoCache::loadLeverageBrackets(const json& brackets) {
+    // Asked for one symbol, the endpoint may answer with a bare object.
+    const json list = brackets.is_array() ? brackets : json::array({brackets});
+
+    std::lock_guard<std::mutex> write(writeMutex_);
+    auto next = std::make_shared<Snapshot>();
+    if (auto previous = snapshot()) {
+        *next = *previous;
+    }
+    for (const auto& entry : list) {
+        const std::string symbol = entry.at("symbol").get<std::string>();
+        std::vector<SymbolRules::Bracket> parsed;
+        for (const auto& bracket : entry.at("brackets")) {
+            parsed.push_back({bracket.at("initialLeverage").get<int>(), number_field(bracket, "notionalCap")});
+        }
+        // Symbols exchangeInfo has not listed yet get placeholder rules that
+        // do not trade until it does.
+        auto [it, inserted] = next->ids.emplace(symbol, static_cast<SymbolId>(next->rules.size()));
+        if (inserted) {
+            next->rules.emplace_back();
+            next->rules.back().symbol = symbol;
+        }
+        next->rules[it->second].brackets = std::move(parsed);
+    }
+    publish(std::move(next));
+}
+
+void ExchangeInfoCache::publish(std::shared_ptr<const Snapshot> next) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot_ = std::move(next);
+}
+
+void ExchangeInfoCache::refreshFrom(const Fetch& fetch) {
+    std::unique_lock<std::mutex> lock(refreshMutex_);
+    if (refreshing_) {
+        const std::uint64_t inFlight = refreshes_;
+        refreshDone_.wait(lock, [&] { return refreshes_ != inFlight; });
+        if (!lastError_.empty()) {
+            throw std::runtime_error("exchangeInfo refresh failed: " + lastError_);
+        }
+        return;
+    }
+    refreshing_ = true;
+    lock.unlock();
+
+    std::string error;
+    try {
+        load(fetch());
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+
+    lock.lock();
+    refreshing_ = false;
+    ++refreshes_;
+    lastError_ = error;
+    lock.unlock();
+    refreshDone_.notify_all();
+    if (!error.empty()) {
+        throw std::runtime_error("exchangeInfo refresh failed: " + error);
+    }
+}
+
+bool ExchangeInfoCache::tryRefresh(const Fetch& fetch) {
+    try {
+        refreshFrom(fetch);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+void ExchangeInfoCache::startFrom(Fetch fetch) {
+    {
+        std::lock_guard<std::mutex> lock(runMutex_);
+        if (running_) {
+            return;
+        }
+        running_ = true;
+    }
+    const bool loadedNow = tryRefresh(fetch);
+    thread_ = std::thread([this, fetch = std::move(fetch), succeeded = loadedNow]() mutable {
+        std::unique_lock<std::mutex> lock(runMutex_);
+        while (!wake_.wait_for(lock, succeeded ? options_.maxAge : options_.retryInterval, [this] { return !running_; })) {
+            lock.unlock();
+            succeeded = tryRefresh(fetch);
+            lock.lock();
+        }
+    });
+}
+
+void ExchangeInfoCache::stop() {
+    {
+        std::lock_guard<std::mutex> lock(runMutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::string ExchangeInfoCache::lastError() const {
+    std::lock_guard<std::mutex> lock(refreshMutex_);
+    return lastError_;
+}
+
+std::shared_ptr<const ExchangeInfoCache::Snapshot> ExchangeInfoCache::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return snapshot_;
+}
+
+bool ExchangeInfoCache::loaded() const {
+    auto current = snapshot();
+    return current && current->loadedAt != std::chrono::steady_clock::time_point{};
+}
+
+bool ExchangeInfoCache::stale() const {
+    auto current = snapshot();
+    return !current || std::chrono::steady_clock::now() - current->loadedAt >= options_.maxAge;
+}
+
+std::size_t ExchangeInfoCache::size() const {
+    auto current = snapshot();
+    return current ? current->rules.size() : 0;
+}
+
+ExchangeInfoCache::SymbolId ExchangeInfoCache::symbolId(const std::string& symbol) const {
+    auto current = snapshot();
+    if (!current) {
+        return kUnknownSymbol;
+    }
+    auto it = current->ids.find(symbol);
+    return it == current->ids.end() ? kUnknownSymbol : it->second;
+}
+
+std::shared_ptr<const ExchangeInfoCache::SymbolRules> ExchangeInfoCache::rules(SymbolId symbol) const {
+    auto current = snapshot();
+    if (!current || symbol >= current->rules.size()) {
+        return nullptr;
+    }
+    // Aliases the snapshot, so the rules outlive any later refresh.
+    return std::shared_ptr<const SymbolRules>(current, &current->rules[symbol]);
+}
+
+std::shared_ptr<const ExchangeInfoCache::SymbolRules> ExchangeInfoCache::rules(const std::string& symbol) const {
+    auto current = snapshot();
+    if (!current) {
+        return nullptr;
+    }
+    auto it = current->ids.find(symbol);
+    if (it == current->ids.end()) {
+        return nullptr;
+    }
+    return std::shared_ptr<const SymbolRules>(current, &current->rules[it->second]);
+}
+
+ExchangeInfoCache::Verdict ExchangeInfoCache::validate(const SymbolRules& rules, const OrderCheck& order) {
+    if (!rules.trading) {
+        return Verdict::NOT_TRADING;
+    }
+    if (order.price) {
+        if (const Verdict verdict = check_price(rules, *order.price); verdict != Verdict::OK) {
+            return verdict;
+        }
+    }
+    if (order.stopPrice) {
+        if (const Verdict verdict = check_price(rules, *order.stopPrice); verdict != Verdict::OK) {
+            return verdict;
+        }
+    }
+    if (order.quantity) {
+        std::int64_t units = 0;
+        if (!to_units(*order.quantity, rules.quantityScale, units)) {
+            return Verdict::QUANTITY_PRECISION;
+        }
+        if (units <= 0) {
+            return Verdict::QUANTITY_NOT_POSITIVE;
+        }
+        const std::int64_t step = order.market ? rules.marketStepSize : rules.stepSize;
+        const std::int64_t minQty = order.market ? rules.marketMinQty : rules.minQty;
+        const std::int64_t maxQty = order.market ? rules.marketMaxQty : rules.maxQty;
+        if (units % step != 0) {
+            return Verdict::QUANTITY_STEP;
+        }
+        if (units < minQty) {
+            return Verdict::QUANTITY_TOO_LOW;
+        }
+        if (maxQty > 0 && units > maxQty) {
+            return Verdict::QUANTITY_TOO_HIGH;
+        }
+        if (order.price && !order.reduceOnly) {
+            const double notional = *order.price * *order.quantity;
+            if (notional < rules.minNotional * (1.0 - 1e-12)) {
+                return Verdict::NOTIONAL_TOO_SMALL;
+            }
+            if (order.leverage > 0 && notional > maxNotional(rules, order.leverage) * (1.0 + 1e-12)) {
+                return Verdict::LEVERAGE_NOTIONAL_EXCEEDED;
+            }
+        }
+    }
+    return Verdict::OK;
+}
+
+double ExchangeInfoCache::maxNotional(const SymbolRules& rules, int leverage) {
+    if (rules.brackets.empty()) {
+        return std::numeric_limits<double>::infinity();
+    }
+    double cap = 0.0;
+    for (const auto& bracket : rules.brackets) {
+        if (bracket.initialLeverage >= leverage) {
+            cap = std::max(cap, bracket.notionalCap);
+        }
+    }
+    return cap;
+}
+
+std::string ExchangeInfoCache::formatPrice(const SymbolRules& rules, double price) {
+    return format_units(static_cast<std::int64_t>(std::llround(price * rules.priceScale)), rules.priceDecimals);
+}
+
+std::string ExchangeInfoCache::formatQuantity(const SymbolRules& rules, double quantity) {
+    return format_units(static_cast<std::int64_t>(std::llround(quantity * rules.quantityScale)), rules.quantityDecimals);
+}
+
+json ExchangeInfoCache::toJson(const SymbolRules& rules) {
+    json result{
+        {"symbol", rules.symbol},
+        {"trading", rules.trading},
+        {"tickSize", format_units(rules.tickSize, rules.priceDecimals)},
+        {"minPrice", format_units(rules.minPrice, rules.priceDecimals)},
+        {"maxPrice", format_units(rules.maxPrice, rules.priceDecimals)},
+        {"stepSize", format_units(rules.stepSize, rules.quantityDecimals)},
+        {"minQty", format_units(rules.minQty, rules.quantityDecimals)},
+        {"maxQty", format_units(rules.maxQty, rules.quantityDecimals)},
+        {"marketStepSize", format_units(rules.marketStepSize, rules.quantityDecimals)},
+        {"marketMinQty", format_units(rules.marketMinQty, rules.quantityDecimals)},
+        {"marketMaxQty", format_units(rules.marketMaxQty, rules.quantityDecimals)},
+        {"minNotional", rules.minNotional}
+    };
+    if (!rules.brackets.empty()) {
+        json brackets = json::array();
+        for (const auto& bracket : rules.brackets) {
+            brackets.push_back({{"initialLeverage", bracket.initialLeverage}, {"notionalCap", bracket.notionalCap}});
+        }
+        result["brackets"] = std::move(brackets);
+    }
+    return result;
+}
+
+int ExchangeInfoCache::errorCode(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::OK:
+            return 0;
+        case Verdict::UNKNOWN_SYMBOL:
+            return -1121;
+        case Verdict::NOT_TRADING:
+            return -4140;
+        case Verdict::PRICE_PRECISION:
+        case Verdict::QUANTITY_PRECISION:
+            return -1111;
+        case Verdict::PRICE_TICK:
+            return -4014;
+        case Verdict::PRICE_TOO_LOW:
+            return -4013;
+        case Verdict::PRICE_TOO_HIGH:
+            return -4016;
+        case Verdict::QUANTITY_NOT_POSITIVE:
+            return -4003;
+        case Verdict::QUANTITY_STEP:
+            return -4023;
+        case Verdict::QUANTITY_TOO_LOW:
+            return -4004;
+        case Verdict::QUANTITY_TOO_HIGH:
+            return -4005;
+        case Verdict::NOTIONAL_TOO_SMALL:
+            return -4164;
+        case Verdict::LEVERAGE_NOTIONAL_EXCEEDED:
+            return -2027;
+    }
+    return -1;
+}
+
+const char* ExchangeInfoCache::message(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::OK:
+            return "OK";
+        case Verdict::UNKNOWN_SYMBOL:
+            return "Invalid symbol.";
+        case Verdict::NOT_TRADING:
+            return "Invalid symbol status for opening position.";
+        case Verdict::PRICE_PRECISION:
+        case Verdict::QUANTITY_PRECISION:
+            return "Precision is over the maximum defined for this asset.";
+        case Verdict::PRICE_TICK:
+            return "Price not increased by tick size.";
+        case Verdict::PRICE_TOO_LOW:
+            return "Price less than min price.";
+        case Verdict::PRICE_TOO_HIGH:
+            return "Price greater than max price.";
+        case Verdict::QUANTITY_NOT_POSITIVE:
+            return "Quantity less than or equal to zero.";
+        case Verdict::QUANTITY_STEP:
+            return "Quantity not increased by step size.";
+        case Verdict::QUANTITY_TOO_LOW:
+            return "Quantity less than min quantity.";
+        case Verdict::QUANTITY_TOO_HIGH:
+            return "Quantity greater than max quantity.";
+        case Verdict::NOTIONAL_TOO_SMALL:
+            return "Order's notional must be no smaller than the minimum notional (unless you choose reduce only).";
+        case Verdict::LEVERAGE_NOTIONAL_EXCEEDED:
+            return "Exceeded the maximum allowable position at current leverage.";
+    }
+    return "Unknown error.";
+}
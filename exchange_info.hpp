@@ -0,0 +1,194 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Symbol trading rules from /fapi/v1/exchangeInfo, precomputed into a dense
+// table of scaled integers indexed by symbol id. Orders are checked against
+// it and their prices and quantities formatted at exactly the symbol's
+// precision without a round trip. A refresh publishes a new immutable
+// snapshot; ids stay stable across refreshes.
+class ExchangeInfoCache {
+public:
+    using SymbolId = std::uint32_t;
+    static constexpr SymbolId kUnknownSymbol = ~SymbolId{0};
+
+    struct Options {
+        // Age after which stale() reports true; start() reloads this often.
+        std::chrono::seconds maxAge{3600};
+        // Delay before start() retries a failed reload.
+        std::chrono::seconds retryInterval{10};
+    };
+
+    // Price fields are in units of 10^-priceDecimals, quantity fields in
+    // units of 10^-quantityDecimals. A zero maximum means unbounded.
+    struct SymbolRules {
+        std::string symbol;
+        bool trading = false;
+        std::uint8_t priceDecimals = 0;
+        std::uint8_t quantityDecimals = 0;
+        double priceScale = 1.0;
+        double quantityScale = 1.0;
+        std::int64_t tickSize = 1;
+        std::int64_t minPrice = 0;
+        std::int64_t maxPrice = 0;
+        std::int64_t stepSize = 1;
+        std::int64_t minQty = 0;
+        std::int64_t maxQty = 0;
+        std::int64_t marketStepSize = 1;
+        std::int64_t marketMinQty = 0;
+        std::int64_t marketMaxQty = 0;
+        double minNotional = 0.0;
+
+        struct Bracket {
+            int initialLeverage = 0;
+            double notionalCap = 0.0;
+        };
+        // From /fapi/v1/leverageBracket; empty until loadLeverageBrackets().
+        std::vector<Bracket> brackets;
+    };
+
+    struct OrderCheck {
+        bool market = false;
+        bool reduceOnly = false;
+        std::optional<double> quantity;
+        std::optional<double> price;
+        std::optional<double> stopPrice;
+        // The account's leverage on the symbol; 0 skips the bracket check.
+        int leverage = 0;
+    };
+
+    enum class Verdict : std::uint8_t {
+        OK,
+        UNKNOWN_SYMBOL,
+        NOT_TRADING,
+        PRICE_PRECISION,
+        PRICE_TICK,
+        PRICE_TOO_LOW,
+        PRICE_TOO_HIGH,
+        QUANTITY_PRECISION,
+        QUANTITY_NOT_POSITIVE,
+        QUANTITY_STEP,
+        QUANTITY_TOO_LOW,
+        QUANTITY_TOO_HIGH,
+        NOTIONAL_TOO_SMALL,
+        LEVERAGE_NOTIONAL_EXCEEDED
+    };
+
+    ExchangeInfoCache();
+    explicit ExchangeInfoCache(Options options);
+    ~ExchangeInfoCache();
+
+    ExchangeInfoCache(const ExchangeInfoCache&) = delete;
+    ExchangeInfoCache& operator=(const ExchangeInfoCache&) = delete;
+
+    // Replaces the rules with an exchangeInfo payload.
+    void load(const nlohmann::json& exchangeInfo);
+
+    // Attaches a leverageBracket payload to the symbols' rules. Brackets can
+    // differ per account, so load them through the account that trades.
+    // They are kept across exchangeInfo reloads.
+    void loadLeverageBrackets(const nlohmann::json& brackets);
+
+    template <typename Client>
+    void refreshLeverageBrackets(Client& client) {
+        loadLeverageBrackets(client.getLeverageBrackets());
+    }
+
+    // Downloads and loads exchangeInfo. Concurrent callers share a single
+    // download: later ones wait for the one in flight instead of starting
+    // their own. A failed download leaves the current snapshot in use and
+    // throws to every caller that waited on it.
+    template <typename Client>
+    void refresh(Client& client) {
+        refreshFrom([&client] { return client.getExchangeInfo(); });
+    }
+
+    // Loads once before returning, then reloads every maxAge on a background
+    // thread, so orders never wait on the download. Failures keep the current
+    // snapshot and are retried after retryInterval. `client` must outlive
+    // stop().
+    template <typename Client>
+    void start(Client& client) {
+        startFrom([&client] { return client.getExchangeInfo(); });
+    }
+    void stop();
+
+    bool loaded() const;
+    bool stale() const;
+    std::size_t size() const;
+    // Why the last download failed; empty once one succeeds.
+    std::string lastError() const;
+
+    SymbolId symbolId(const std::string& symbol) const;
+
+    // Null for symbols the current snapshot does not know. The rules stay
+    // valid for as long as the pointer is held, across refreshes.
+    std::shared_ptr<const SymbolRules> rules(SymbolId symbol) const;
+    std::shared_ptr<const SymbolRules> rules(const std::string& symbol) const;
+
+    // Checks tick and step alignment, price and quantity ranges, minimum
+    // notional and the leverage bracket's notional cap without allocating.
+    // Notional is only checked for orders with a price, since market orders
+    // have no local reference price. The bracket check covers the order
+    // alone; the exchange also counts the position already open.
+    static Verdict validate(const SymbolRules& rules, const OrderCheck& order);
+
+    // Largest position notional allowed at `leverage`; infinite when no
+    // brackets are loaded and 0 when the leverage exceeds every bracket.
+    static double maxNotional(const SymbolRules& rules, int leverage);
+
+    // Exact decimal text at the symbol's precision, e.g. "0.0310" for a
+    // 0.0001 tick. Values are expected to have passed validate().
+    static std::string formatPrice(const SymbolRules& rules, double price);
+    static std::string formatQuantity(const SymbolRules& rules, double quantity);
+
+    static nlohmann::json toJson(const SymbolRules& rules);
+
+    // The exchange's own error code and message for a verdict.
+    static int errorCode(Verdict verdict);
+    static const char* message(Verdict verdict);
+
+private:
+    using Fetch = std::function<nlohmann::json()>;
+
+    struct Snapshot {
+        std::unordered_map<std::string, SymbolId> ids;
+        std::vector<SymbolRules> rules;
+        std::chrono::steady_clock::time_point loadedAt;
+    };
+
+    std::shared_ptr<const Snapshot> snapshot() const;
+    void publish(std::shared_ptr<const Snapshot> next);
+    void refreshFrom(const Fetch& fetch);
+    bool tryRefresh(const Fetch& fetch);
+    void startFrom(Fetch fetch);
+
+    Options options_;
+    mutable std::mutex mutex_;
+    std::shared_ptr<const Snapshot> snapshot_;
+    // Serialises copy-and-publish between exchangeInfo and bracket loads.
+    std::mutex writeMutex_;
+
+    mutable std::mutex refreshMutex_;
+    std::condition_variable refreshDone_;
+    bool refreshing_ = false;
+    std::uint64_t refreshes_ = 0;
+    std::string lastError_;
+
+    std::mutex runMutex_;
+    std::condition_variable wake_;
+    bool running_ = false;
+    std::thread thread_;
+};
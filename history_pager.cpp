@@ -0,0 +1,212 @@
+#include "history_pager.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+// allOrders rejects time ranges of 7 days or more.
+constexpr long long kOrderWindowMs = 7LL * 24 * 60 * 60 * 1000 - 1;
+
+long long read_integer(const json& entry, const char* key) {
+    const auto& value = entry.at(key);
+    if (value.is_string()) {
+        return std::stoll(value.get<std::string>());
+    }
+    return value.get<long long>();
+}
+
+bool past_end(const BinanceFuturesClient::HistoryRange& range, long long time) {
+    return range.endTime && time > *range.endTime;
+}
+
+long long current_timestamp_ms() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+// Time-paged endpoints restart each page at the previous page's last
+// timestamp, since several entries can share it. This remembers what was
+// delivered at that timestamp and drops it from the next page.
+template <typename Key>
+class BoundaryFilter {
+public:
+    template <typename KeyOf>
+    void apply(json& page, KeyOf keyOf) {
+        page.erase(std::remove_if(page.begin(), page.end(),
+                                  [&](const json& entry) {
+                                      return read_integer(entry, "time") == time_ && keys_.count(keyOf(entry)) > 0;
+                                  }),
+                   page.end());
+        if (page.empty()) {
+            return;
+        }
+        const long long lastTime = read_integer(page.back(), "time");
+        if (lastTime != time_) {
+            time_ = lastTime;
+            keys_.clear();
+        }
+        for (const auto& entry : page) {
+            if (read_integer(entry, "time") == lastTime) {
+                keys_.insert(keyOf(entry));
+            }
+        }
+    }
+
+private:
+    long long time_ = -1;
+    std::set<Key> keys_;
+};
+
+// A full page with nothing new means more than a page of entries share one
+// millisecond. Time cursors cannot get past that without losing entries.
+[[noreturn]] void throw_stuck(const char* endpoint, long long time) {
+    throw std::runtime_error(std::string(endpoint) + " has more entries at time " + std::to_string(time) +
+                             " than fit in one page; raise pageSize to read them all");
+}
+}  // namespace
+
+HistoryPager::HistoryPager(FetchPage fetch, Advance advance, Range range)
+    : fetch_(std::move(fetch)),
+      advance_(std::move(advance)),
+      current_(range) {
+    prefetch(current_);
+}
+
+HistoryPager::~HistoryPager() {
+    if (pending_.valid()) {
+        pending_.wait();
+    }
+}
+
+void HistoryPager::prefetch(const Range& range) {
+    pending_ = std::async(std::launch::async, fetch_, range);
+}
+
+std::optional<json> HistoryPager::next() {
+    // Pages left empty, such as quiet order windows or entries dropped as
+    // already delivered, are skipped until one has entries.
+    while (!done_ && pending_.valid()) {
+        json page = pending_.get();
+        done_ = true;
+        if (!page.is_array()) {
+            throw std::runtime_error("Unexpected response for history page");
+        }
+
+        auto following = advance_(page, current_);
+        if (following) {
+            done_ = false;
+            current_ = *following;
+            prefetch(current_);
+        }
+
+        if (!page.empty()) {
+            return page;
+        }
+    }
+    return std::nullopt;
+}
+
+HistoryPager HistoryPager::pageAllOrders(FetchPage fetch, Range range, int pageSize) {
+    // Without a cursor the endpoint returns the most recent orders, which
+    // cannot be paged forward from.
+    if (!range.startTime && !range.fromId) {
+        throw std::runtime_error("Order history needs a startTime or fromId to page from");
+    }
+
+    if (range.fromId) {
+        // Orders with orderId >= fromId come back in ascending order, so the
+        // cursor simply moves past the last orderId seen. Time bounds are
+        // applied locally; sent along they would be subject to the 7-day
+        // limit.
+        const Range bounds = range;
+        auto advance = [pageSize, bounds](json& page, const Range& cursor) -> std::optional<Range> {
+            if (page.empty()) {
+                return std::nullopt;
+            }
+            const bool full = static_cast<int>(page.size()) >= pageSize;
+            const long long lastId = read_integer(page.back(), "orderId");
+            const long long lastTime = read_integer(page.back(), "time");
+            page.erase(std::remove_if(page.begin(), page.end(),
+                                      [&](const json& entry) {
+                                          const long long time = read_integer(entry, "time");
+                                          return (bounds.startTime && time < *bounds.startTime) || past_end(bounds, time);
+                                      }),
+                       page.end());
+            if (!full || past_end(bounds, lastTime)) {
+                return std::nullopt;
+            }
+            Range following = cursor;
+            following.fromId = lastId + 1;
+            return following;
+        };
+        return HistoryPager(std::move(fetch), std::move(advance), Range{std::nullopt, std::nullopt, range.fromId});
+    }
+
+    // By time, the range is walked in windows shorter than 7 days. A full
+    // page continues from its last timestamp within the same window.
+    const long long end = range.endTime.value_or(current_timestamp_ms());
+    auto boundary = std::make_shared<BoundaryFilter<long long>>();
+    auto advance = [pageSize, end, boundary](json& page, const Range& cursor) -> std::optional<Range> {
+        const bool full = static_cast<int>(page.size()) >= pageSize;
+        boundary->apply(page, [](const json& entry) { return read_integer(entry, "orderId"); });
+
+        Range following = cursor;
+        if (full) {
+            if (page.empty()) {
+                throw_stuck("allOrders", *cursor.startTime);
+            }
+            following.startTime = read_integer(page.back(), "time");
+            return following;
+        }
+        if (*cursor.endTime >= end) {
+            return std::nullopt;
+        }
+        following.startTime = *cursor.endTime + 1;
+        following.endTime = std::min(*following.startTime + kOrderWindowMs, end);
+        return following;
+    };
+
+    Range first{range.startTime, std::min(*range.startTime + kOrderWindowMs, end), std::nullopt};
+    return HistoryPager(std::move(fetch), std::move(advance), first);
+}
+
+HistoryPager HistoryPager::pageIncome(FetchPage fetch, Range range, int pageSize) {
+    if (!range.startTime) {
+        range.startTime = 0;
+    }
+
+    // The income endpoint only pages by time, so each page restarts at the
+    // previous page's last timestamp. tranId is only unique within one
+    // incomeType, so entries are recognised by both.
+    using IncomeKey = std::pair<std::string, long long>;
+    auto boundary = std::make_shared<BoundaryFilter<IncomeKey>>();
+    auto advance = [pageSize, boundary](json& page, const Range& cursor) -> std::optional<Range> {
+        const bool full = static_cast<int>(page.size()) >= pageSize;
+        boundary->apply(page, [](const json& entry) {
+            return IncomeKey(entry.value("incomeType", std::string{}), read_integer(entry, "tranId"));
+        });
+
+        if (!full) {
+            return std::nullopt;
+        }
+        if (page.empty()) {
+            throw_stuck("income", *cursor.startTime);
+        }
+        const long long lastTime = read_integer(page.back(), "time");
+        if (past_end(cursor, lastTime)) {
+            return std::nullopt;
+        }
+        Range following = cursor;
+        following.startTime = lastTime;
+        return following;
+    };
+
+    return HistoryPager(std::move(fetch), std::move(advance), range);
+}
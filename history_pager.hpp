@@ -0,0 +1,79 @@
+#pragma once
+
+#include "binance_client.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+
+class HistoryPager {
+public:
+    using Range = BinanceFuturesClient::HistoryRange;
+
+    // Pages forward from range.fromId, or else from range.startTime in
+    // windows the endpoint accepts; one of the two is required. Works with
+    // any client exposing getAllOrders(symbol, Range, limit), which must
+    // outlive the pager.
+    template <typename Client>
+    static HistoryPager allOrders(Client& client,
+                                  std::string symbol,
+                                  Range range = {},
+                                  int pageSize = 1000) {
+        FetchPage fetch = [&client, symbol = std::move(symbol), pageSize](const Range& cursor) {
+            return client.getAllOrders(symbol, cursor, pageSize);
+        };
+        return pageAllOrders(std::move(fetch), range, pageSize);
+    }
+
+    // Pages forward from range.startTime, or from the epoch if unset.
+    template <typename Client>
+    static HistoryPager income(Client& client,
+                               std::string symbol,
+                               std::string incomeType,
+                               Range range = {},
+                               int pageSize = 1000) {
+        FetchPage fetch = [&client, symbol = std::move(symbol), incomeType = std::move(incomeType), pageSize](const Range& cursor) {
+            return client.getIncomeHistory(symbol, incomeType, cursor, pageSize);
+        };
+        return pageIncome(std::move(fetch), range, pageSize);
+    }
+
+    HistoryPager(HistoryPager&&) = default;
+    HistoryPager& operator=(HistoryPager&&) = default;
+    ~HistoryPager();
+
+    // Returns the next page, or nullopt once the history is exhausted. The
+    // following page is already in flight by the time this returns.
+    std::optional<nlohmann::json> next();
+
+    template <typename Callback>
+    void forEach(Callback&& callback) {
+        while (auto page = next()) {
+            for (const auto& entry : *page) {
+                callback(entry);
+            }
+        }
+    }
+
+private:
+    using FetchPage = std::function<nlohmann::json(const Range&)>;
+    // Trims entries already delivered and returns the cursor for the next
+    // page, or nullopt when this page was the last one.
+    using Advance = std::function<std::optional<Range>(nlohmann::json&, const Range&)>;
+
+    HistoryPager(FetchPage fetch, Advance advance, Range range);
+
+    static HistoryPager pageAllOrders(FetchPage fetch, Range range, int pageSize);
+    static HistoryPager pageIncome(FetchPage fetch, Range range, int pageSize);
+
+    void prefetch(const Range& range);
+
+    FetchPage fetch_;
+    Advance advance_;
+    Range current_;
+    std::future<nlohmann::json> pending_;
+    bool done_ = false;
+};
@@ -0,0 +1,248 @@
+#include "kline_aggregator.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+constexpr std::int64_t kDayMs = 24LL * 60 * 60 * 1000;
+constexpr std::int64_t kWeekMs = 7 * kDayMs;
+// 1970-01-01 was a Thursday; weekly candles open on Mondays.
+constexpr std::int64_t kWeekOffsetMs = 4 * kDayMs;
+
+std::int64_t bucket_offset(std::int64_t intervalMs) {
+    return intervalMs % kWeekMs == 0 ? kWeekOffsetMs : 0;
+}
+
+void check_divides(std::int64_t sourceMs, std::int64_t intervalMs, const std::string& interval) {
+    if (intervalMs < sourceMs || intervalMs % sourceMs != 0 || bucket_offset(intervalMs) % sourceMs != 0) {
+        throw std::runtime_error("Interval " + interval + " is not a whole multiple of the source interval");
+    }
+}
+
+struct Max {
+    template <typename T>
+    T operator()(T a, T b) const { return a < b ? b : a; }
+};
+
+struct Min {
+    template <typename T>
+    T operator()(T a, T b) const { return b < a ? b : a; }
+};
+
+struct Sum {
+    template <typename T>
+    T operator()(T a, T b) const { return a + b; }
+};
+
+// `buckets` consecutive full buckets of `ratio` rows each. The loop over
+// buckets is innermost and every output lane is independent, so it
+// vectorises without reassociating the reduction.
+template <typename T, typename Op>
+void fold_uniform(const T* in, T* out, std::size_t buckets, std::size_t ratio, Op op) {
+    for (std::size_t j = 0; j < buckets; ++j) {
+        out[j] = in[j * ratio];
+    }
+    for (std::size_t k = 1; k < ratio; ++k) {
+        for (std::size_t j = 0; j < buckets; ++j) {
+            out[j] = op(out[j], in[j * ratio + k]);
+        }
+    }
+}
+
+template <typename T, typename Op>
+T fold_range(const T* in, std::size_t count, Op op) {
+    T result = in[0];
+    for (std::size_t i = 1; i < count; ++i) {
+        result = op(result, in[i]);
+    }
+    return result;
+}
+
+// Rolls source rows [first, first + count) into output rows
+// [row, row + buckets). Either every bucket spans count / buckets rows, or
+// there is a single bucket of any length.
+void fold_columns(const KlineSeries& source, std::size_t first, std::size_t count,
+                  KlineSeries& out, std::size_t row, std::size_t buckets) {
+    const std::size_t ratio = count / buckets;
+    auto column = [&](const auto& in, auto& result, auto op) {
+        if (buckets == 1) {
+            result[row] = fold_range(in.data() + first, count, op);
+        } else {
+            fold_uniform(in.data() + first, result.data() + row, buckets, ratio, op);
+        }
+    };
+    for (std::size_t j = 0; j < buckets; ++j) {
+        out.open[row + j] = source.open[first + j * ratio];
+        out.close[row + j] = source.close[first + j * ratio + ratio - 1];
+    }
+    column(source.high, out.high, Max{});
+    column(source.low, out.low, Min{});
+    column(source.volume, out.volume, Sum{});
+    column(source.quoteVolume, out.quoteVolume, Sum{});
+    column(source.trades, out.trades, Sum{});
+    column(source.takerBuyVolume, out.takerBuyVolume, Sum{});
+    column(source.takerBuyQuoteVolume, out.takerBuyQuoteVolume, Sum{});
+}
+
+void resize(KlineSeries& series, std::size_t count) {
+    series.openTime.resize(count);
+    series.open.resize(count);
+    series.high.resize(count);
+    series.low.resize(count);
+    series.close.resize(count);
+    series.volume.resize(count);
+    series.quoteVolume.resize(count);
+    series.trades.resize(count);
+    series.takerBuyVolume.resize(count);
+    series.takerBuyQuoteVolume.resize(count);
+}
+}  // namespace
+
+std::int64_t KlineAggregator::bucketStart(std::int64_t time, std::int64_t intervalMs) {
+    const std::int64_t offset = bucket_offset(intervalMs);
+    std::int64_t remainder = (time - offset) % intervalMs;
+    if (remainder < 0) {
+        remainder += intervalMs;
+    }
+    return time - remainder;
+}
+
+KlineSeries KlineAggregator::aggregate(const KlineSeries& source, const std::string& interval) {
+    return aggregate(source, interval, 0, source.size());
+}
+
+KlineSeries KlineAggregator::aggregate(const KlineSeries& source, const std::string& interval, std::size_t begin, std::size_t end) {
+    KlineSeries out(interval);
+    check_divides(source.intervalMs, out.intervalMs, interval);
+    end = std::min(end, source.size());
+    if (begin >= end) {
+        return out;
+    }
+    const std::size_t ratio = static_cast<std::size_t>(out.intervalMs / source.intervalMs);
+
+    // Bucket boundaries first, so each column is then reduced in its own
+    // pass over contiguous memory.
+    std::vector<std::size_t> bounds;
+    bounds.reserve((end - begin) / ratio + 2);
+    out.openTime.reserve((end - begin) / ratio + 1);
+    std::int64_t bucketEnd = std::numeric_limits<std::int64_t>::min();
+    for (std::size_t i = begin; i < end; ++i) {
+        if (source.openTime[i] >= bucketEnd) {
+            const std::int64_t open = bucketStart(source.openTime[i], out.intervalMs);
+            out.openTime.push_back(open);
+            bounds.push_back(i);
+            bucketEnd = open + out.intervalMs;
+        }
+    }
+    bounds.push_back(end);
+    const std::size_t buckets = out.openTime.size();
+    resize(out, buckets);
+
+    // Runs of gap-free buckets take the vectorised path; partial buckets at
+    // the edges and around gaps are folded one at a time.
+    std::size_t b = 0;
+    while (b < buckets) {
+        std::size_t run = b;
+        while (run < buckets && bounds[run + 1] - bounds[run] == ratio) {
+            ++run;
+        }
+        if (run > b) {
+            fold_columns(source, bounds[b], bounds[run] - bounds[b], out, b, run - b);
+            b = run;
+        } else {
+            fold_columns(source, bounds[b], bounds[b + 1] - bounds[b], out, b, 1);
+            ++b;
+        }
+    }
+    return out;
+}
+
+KlineAggregator::KlineAggregator(const std::string& sourceInterval, const std::vector<std::string>& intervals)
+    : sourceMs_(KlineSeries::intervalToMs(sourceInterval)),
+      lastOpenTime_(std::numeric_limits<std::int64_t>::min()) {
+    targets_.reserve(intervals.size());
+    for (const auto& interval : intervals) {
+        Target target{KlineSeries(interval)};
+        check_divides(sourceMs_, target.series.intervalMs, interval);
+        targets_.push_back(std::move(target));
+    }
+}
+
+void KlineAggregator::setCloseCallback(CloseCallback callback) {
+    onClose_ = std::move(callback);
+}
+
+void KlineAggregator::append(const KlineSeries& source, std::size_t index) {
+    const std::int64_t openTime = source.openTime[index];
+    if (openTime <= lastOpenTime_) {
+        return;
+    }
+    lastOpenTime_ = openTime;
+    const std::int64_t closeTime = openTime + sourceMs_ - 1;
+
+    for (auto& target : targets_) {
+        KlineSeries& series = target.series;
+        if (series.empty() || openTime >= series.openTime.back() + series.intervalMs) {
+            // A gap can skip a bucket's final candle; the bucket still ends
+            // once the next one begins.
+            if (target.closed < series.size()) {
+                close(target);
+            }
+            series.openTime.push_back(bucketStart(openTime, series.intervalMs));
+            series.open.push_back(source.open[index]);
+            series.high.push_back(source.high[index]);
+            series.low.push_back(source.low[index]);
+            series.close.push_back(source.close[index]);
+            series.volume.push_back(source.volume[index]);
+            series.quoteVolume.push_back(source.quoteVolume[index]);
+            series.trades.push_back(source.trades[index]);
+            series.takerBuyVolume.push_back(source.takerBuyVolume[index]);
+            series.takerBuyQuoteVolume.push_back(source.takerBuyQuoteVolume[index]);
+        } else {
+            const std::size_t last = series.size() - 1;
+            series.high[last] = std::max(series.high[last], source.high[index]);
+            series.low[last] = std::min(series.low[last], source.low[index]);
+            series.close[last] = source.close[index];
+            series.volume[last] += source.volume[index];
+            series.quoteVolume[last] += source.quoteVolume[index];
+            series.trades[last] += source.trades[index];
+            series.takerBuyVolume[last] += source.takerBuyVolume[index];
+            series.takerBuyQuoteVolume[last] += source.takerBuyQuoteVolume[index];
+        }
+        if (closeTime == series.closeTime(series.size() - 1)) {
+            close(target);
+        }
+    }
+}
+
+void KlineAggregator::appendNew(const KlineSeries& source) {
+    for (; consumed_ < source.size(); ++consumed_) {
+        append(source, consumed_);
+    }
+}
+
+void KlineAggregator::close(Target& target) {
+    const std::size_t index = target.closed++;
+    if (onClose_) {
+        onClose_(target.series, index);
+    }
+}
+
+const KlineSeries& KlineAggregator::series(const std::string& interval) const {
+    return target(interval).series;
+}
+
+std::size_t KlineAggregator::closedCount(const std::string& interval) const {
+    return target(interval).closed;
+}
+
+const KlineAggregator::Target& KlineAggregator::target(const std::string& interval) const {
+    for (const auto& target : targets_) {
+        if (target.series.interval == interval) {
+            return target;
+        }
+    }
+    throw std::runtime_error("Interval not aggregated: " + interval);
+}
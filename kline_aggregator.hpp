@@ -0,0 +1,59 @@
+#pragma once
+
+#include "kline_series.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Derives higher intervals from a finer kline series (normally 1m), so one
+// interval is fetched and the rest are built locally. Buckets align to the
+// exchange's boundaries: whole multiples of the interval since the epoch,
+// except weeks, which open on Monday 00:00 UTC.
+class KlineAggregator {
+public:
+    // Called when a derived candle closes, with its row in `series`.
+    using CloseCallback = std::function<void(const KlineSeries& series, std::size_t index)>;
+
+    KlineAggregator(const std::string& sourceInterval, const std::vector<std::string>& intervals);
+
+    void setCloseCallback(CloseCallback callback);
+
+    // Folds the closed source candle at `index` into every derived interval.
+    // Candles at or before the last one folded are ignored.
+    void append(const KlineSeries& source, std::size_t index);
+
+    // Folds every source row appended since the previous call.
+    void appendNew(const KlineSeries& source);
+
+    // Derived candles so far. The last row is still forming unless
+    // closedCount() says otherwise.
+    const KlineSeries& series(const std::string& interval) const;
+    std::size_t closedCount(const std::string& interval) const;
+
+    // Rolls rows [begin, end) of `source` up to `interval` in one pass per
+    // column. The last bucket is partial if `source` stops before it closes,
+    // like the exchange's current candle.
+    static KlineSeries aggregate(const KlineSeries& source, const std::string& interval);
+    static KlineSeries aggregate(const KlineSeries& source, const std::string& interval, std::size_t begin, std::size_t end);
+
+    // Open time of the `intervalMs` bucket containing `time`.
+    static std::int64_t bucketStart(std::int64_t time, std::int64_t intervalMs);
+
+private:
+    struct Target {
+        KlineSeries series;
+        std::size_t closed = 0;
+    };
+
+    const Target& target(const std::string& interval) const;
+    void close(Target& target);
+
+    std::int64_t sourceMs_;
+    std::vector<Target> targets_;
+    std::int64_t lastOpenTime_;
+    std::size_t consumed_ = 0;
+    CloseCallback onClose_;
+};
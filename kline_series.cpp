@@ -0,0 +1,181 @@
+#include "kline_series.hpp"
+#include "text_format.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+double to_double(const json& value) {
+    if (value.is_string()) {
+        return std::strtod(value.get_ref<const std::string&>().c_str(), nullptr);
+    }
+    return value.get<double>();
+}
+
+std::int64_t to_integer(const json& value) {
+    if (value.is_string()) {
+        return std::strtoll(value.get_ref<const std::string&>().c_str(), nullptr, 10);
+    }
+    return value.get<std::int64_t>();
+}
+
+bool ends_with(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+}  // namespace
+
+KlineSeries::KlineSeries(std::string intervalName)
+    : interval(std::move(intervalName)),
+      intervalMs(intervalToMs(interval)) {
+}
+
+std::int64_t KlineSeries::intervalToMs(const std::string& interval) {
+    if (interval.size() < 2) {
+        throw std::runtime_error("Unsupported interval: " + interval);
+    }
+    const char unit = interval.back();
+    const std::string digits = interval.substr(0, interval.size() - 1);
+    for (char c : digits) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) {
+            throw std::runtime_error("Unsupported interval: " + interval);
+        }
+    }
+    const std::int64_t count = std::stoll(digits);
+    constexpr std::int64_t minute = 60 * 1000;
+    switch (unit) {
+        case 'm':
+            return count * minute;
+        case 'h':
+            return count * 60 * minute;
+        case 'd':
+            return count * 24 * 60 * minute;
+        case 'w':
+            return count * 7 * 24 * 60 * minute;
+        default:
+            // Monthly candles have no fixed length.
+            throw std::runtime_error("Unsupported interval: " + interval);
+    }
+}
+
+void KlineSeries::reserve(std::size_t count) {
+    openTime.reserve(count);
+    open.reserve(count);
+    high.reserve(count);
+    low.reserve(count);
+    close.reserve(count);
+    volume.reserve(count);
+    quoteVolume.reserve(count);
+    trades.reserve(count);
+    takerBuyVolume.reserve(count);
+    takerBuyQuoteVolume.reserve(count);
+}
+
+void KlineSeries::clear() {
+    openTime.clear();
+    open.clear();
+    high.clear();
+    low.clear();
+    close.clear();
+    volume.clear();
+    quoteVolume.clear();
+    trades.clear();
+    takerBuyVolume.clear();
+    takerBuyQuoteVolume.clear();
+}
+
+void KlineSeries::appendJson(const json& klines) {
+    if (!klines.is_array()) {
+        throw std::runtime_error("Unexpected klines payload");
+    }
+    reserve(size() + klines.size());
+    for (const auto& row : klines) {
+        if (!row.is_array() || row.size() < 6) {
+            throw std::runtime_error("Unexpected kline row");
+        }
+        openTime.push_back(to_integer(row[0]));
+        open.push_back(to_double(row[1]));
+        high.push_back(to_double(row[2]));
+        low.push_back(to_double(row[3]));
+        close.push_back(to_double(row[4]));
+        volume.push_back(to_double(row[5]));
+        quoteVolume.push_back(row.size() > 7 ? to_double(row[7]) : 0.0);
+        trades.push_back(row.size() > 8 ? to_integer(row[8]) : 0);
+        takerBuyVolume.push_back(row.size() > 9 ? to_double(row[9]) : 0.0);
+        takerBuyQuoteVolume.push_back(row.size() > 10 ? to_double(row[10]) : 0.0);
+    }
+}
+
+json KlineSeries::toJson(std::size_t begin, std::size_t end) const {
+    json rows = json::array();
+    for (std::size_t i = begin; i < end && i < size(); ++i) {
+        rows.push_back(json::array({
+            openTime[i],
+            format_decimal(open[i]),
+            format_decimal(high[i]),
+            format_decimal(low[i]),
+            format_decimal(close[i]),
+            format_decimal(volume[i]),
+            closeTime(i),
+            format_decimal(quoteVolume[i]),
+            trades[i],
+            format_decimal(takerBuyVolume[i]),
+            format_decimal(takerBuyQuoteVolume[i]),
+            "0"
+        }));
+    }
+    return rows;
+}
+
+KlineSeries KlineSeries::loadFile(const std::string& path, const std::string& interval) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("Unable to open klines file: " + path);
+    }
+
+    KlineSeries series(interval);
+    if (ends_with(path, ".json")) {
+        series.appendJson(json::parse(input));
+        return series;
+    }
+
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.empty() || !(std::isdigit(static_cast<unsigned char>(line[0])) || line[0] == '-')) {
+            continue;
+        }
+        const char* cursor = line.c_str();
+        char* end = nullptr;
+        double fields[10] = {};
+        int count = 0;
+        while (count < 10 && *cursor) {
+            fields[count++] = std::strtod(cursor, &end);
+            if (end == cursor) {
+                throw std::runtime_error("Malformed klines row: " + line);
+            }
+            cursor = end;
+            while (*cursor == ',' || *cursor == ' ' || *cursor == '\r') {
+                ++cursor;
+            }
+        }
+        if (count < 6) {
+            throw std::runtime_error("Malformed klines row: " + line);
+        }
+        series.openTime.push_back(static_cast<std::int64_t>(fields[0]));
+        series.open.push_back(fields[1]);
+        series.high.push_back(fields[2]);
+        series.low.push_back(fields[3]);
+        series.close.push_back(fields[4]);
+        series.volume.push_back(fields[5]);
+        series.quoteVolume.push_back(fields[6]);
+        series.trades.push_back(static_cast<std::int64_t>(fields[7]));
+        series.takerBuyVolume.push_back(fields[8]);
+        series.takerBuyQuoteVolume.push_back(fields[9]);
+    }
+    return series;
+}
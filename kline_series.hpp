@@ -0,0 +1,48 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Columnar candle storage: one contiguous array per field so scans over a
+// single column stay cache-friendly.
+struct KlineSeries {
+    std::string interval;
+    std::int64_t intervalMs = 0;
+    std::vector<std::int64_t> openTime;
+    std::vector<double> open;
+    std::vector<double> high;
+    std::vector<double> low;
+    std::vector<double> close;
+    std::vector<double> volume;
+    std::vector<double> quoteVolume;
+    std::vector<std::int64_t> trades;
+    std::vector<double> takerBuyVolume;
+    std::vector<double> takerBuyQuoteVolume;
+
+    explicit KlineSeries(std::string intervalName = "1m");
+
+    std::size_t size() const { return openTime.size(); }
+    bool empty() const { return openTime.empty(); }
+
+    void reserve(std::size_t count);
+    void clear();
+
+    std::int64_t closeTime(std::size_t index) const { return openTime[index] + intervalMs - 1; }
+
+    // Parses the array-of-arrays payload returned by the klines endpoints.
+    void appendJson(const nlohmann::json& klines);
+
+    // Same layout as the klines endpoints, for rows [begin, end).
+    nlohmann::json toJson(std::size_t begin, std::size_t end) const;
+
+    // Loads a JSON klines payload (.json) or CSV rows of openTime, open,
+    // high, low, close, volume[, quoteVolume, trades, takerBuyVolume,
+    // takerBuyQuoteVolume]. A header line is skipped.
+    static KlineSeries loadFile(const std::string& path, const std::string& interval);
+
+    static std::int64_t intervalToMs(const std::string& interval);
+};
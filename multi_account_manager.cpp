@@ -0,0 +1,145 @@
+#include "multi_account_manager.hpp"
+
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+json collect(std::future<json>& future) {
+    try {
+        return future.get();
+    } catch (const std::exception& e) {
+        return json{{"error", e.what()}};
+    }
+}
+}  // namespace
+
+MultiAccountManager::AccountState::AccountState(std::string accountName, BinanceFuturesClient accountClient, int ordersPer10s)
+    : name(std::move(accountName)),
+      client(std::move(accountClient)),
+      orderLimiter(std::make_shared<RateLimiter>(ordersPer10s, std::chrono::seconds(10))) {
+}
+
+MultiAccountManager::MultiAccountManager(Options options)
+    : MultiAccountManager({}, options) {
+}
+
+MultiAccountManager::MultiAccountManager(std::vector<Account> accounts, Options options)
+    : options_(options),
+      transport_(std::make_shared<SharedTransport>()),
+      ipLimiter_(std::make_shared<RateLimiter>(options.ipWeightPerMinute, std::chrono::minutes(1))) {
+    for (auto& account : accounts) {
+        addAccount(std::move(account));
+    }
+    const std::size_t workers = options_.workers > 0 ? options_.workers : 1;
+    workers_.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+MultiAccountManager::~MultiAccountManager() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        stopping_ = true;
+    }
+    queueReady_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void MultiAccountManager::addAccount(Account account) {
+    for (const auto& existing : accounts_) {
+        if (existing->name == account.name) {
+            throw std::runtime_error("Duplicate account name: " + account.name);
+        }
+    }
+    auto state = std::make_unique<AccountState>(
+        account.name,
+        BinanceFuturesClient(std::move(account.apiKey), std::move(account.secretKey), options_.useTestnet, options_.recvWindow),
+        options_.accountOrdersPer10s);
+    state->client.setTransport(transport_);
+    state->client.setEndpointPinner(options_.pinner);
+    state->client.setExchangeInfo(options_.exchangeInfo);
+    state->client.setMetrics(options_.metrics);
+    state->client.setJournal(options_.journal);
+    state->client.setRateLimits(ipLimiter_, state->orderLimiter);
+    accounts_.push_back(std::move(state));
+}
+
+void MultiAccountManager::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueReady_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+    }
+}
+
+std::future<json> MultiAccountManager::submit(AccountState& account, Operation operation) {
+    auto task = std::make_shared<std::packaged_task<json()>>([&account, operation = std::move(operation)] {
+        return operation(account.client);
+    });
+    auto future = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        queue_.emplace_back([task] { (*task)(); });
+    }
+    queueReady_.notify_one();
+    return future;
+}
+
+json MultiAccountManager::forEachAccount(const Operation& operation) {
+    std::vector<std::future<json>> futures;
+    futures.reserve(accounts_.size());
+    for (auto& account : accounts_) {
+        futures.push_back(submit(*account, operation));
+    }
+
+    json result = json::object();
+    for (std::size_t i = 0; i < accounts_.size(); ++i) {
+        result[accounts_[i]->name] = collect(futures[i]);
+    }
+    return result;
+}
+
+json MultiAccountManager::snapshotAll(const std::string& symbol) {
+    std::vector<std::future<json>> accountInfo;
+    std::vector<std::future<json>> positions;
+    accountInfo.reserve(accounts_.size());
+    positions.reserve(accounts_.size());
+    for (auto& account : accounts_) {
+        accountInfo.push_back(submit(*account, [](BinanceFuturesClient& client) {
+            return client.getAccountInfo();
+        }));
+        positions.push_back(submit(*account, [symbol](BinanceFuturesClient& client) {
+            return client.getPositionRisk(symbol);
+        }));
+    }
+
+    json result = json::object();
+    for (std::size_t i = 0; i < accounts_.size(); ++i) {
+        result[accounts_[i]->name] = json{
+            {"account", collect(accountInfo[i])},
+            {"positions", collect(positions[i])}
+        };
+    }
+    return result;
+}
+
+json MultiAccountManager::setLeverageAll(const std::string& symbol, int leverage) {
+    return forEachAccount([symbol, leverage](BinanceFuturesClient& client) {
+        return client.setLeverage(symbol, leverage);
+    });
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "binance_client.hpp"
+#include "rate_limiter.hpp"
+#include "shared_transport.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MultiAccountManager {
+public:
+    struct Account {
+        std::string name;
+        std::string apiKey;
+        std::string secretKey;
+    };
+
+    struct Options {
+        bool useTestnet = true;
+        long recvWindow = 5000;
+        std::size_t workers = 32;
+        int ipWeightPerMinute = 2400;
+        int accountOrdersPer10s = 300;
+        // Shared by every account's client; null resolves through DNS as usual.
+        std::shared_ptr<EndpointPinner> pinner;
+        // One symbol-rules cache for all accounts; null sends orders unchecked.
+        std::shared_ptr<ExchangeInfoCache> exchangeInfo;
+        // Shared by every account's client when set.
+        std::shared_ptr<RequestMetrics> metrics;
+        std::shared_ptr<OrderJournal> journal;
+    };
+
+    // Runs against one account's client and returns that account's result.
+    using Operation = std::function<nlohmann::json(BinanceFuturesClient&)>;
+
+    explicit MultiAccountManager(Options options);
+    MultiAccountManager(std::vector<Account> accounts, Options options);
+    ~MultiAccountManager();
+
+    MultiAccountManager(const MultiAccountManager&) = delete;
+    MultiAccountManager& operator=(const MultiAccountManager&) = delete;
+
+    void addAccount(Account account);
+
+    std::size_t size() const { return accounts_.size(); }
+
+    // Runs `operation` for every account concurrently. Each request it makes
+    // is charged its endpoint weight against the shared IP budget and its
+    // order count against that account's order budget. The result is keyed
+    // by account name; failures are reported as {"error": ...}.
+    nlohmann::json forEachAccount(const Operation& operation);
+
+    // getAccountInfo and getPositionRisk for all accounts, all requests in
+    // flight at once.
+    nlohmann::json snapshotAll(const std::string& symbol = "");
+
+    nlohmann::json setLeverageAll(const std::string& symbol, int leverage);
+
+private:
+    struct AccountState {
+        AccountState(std::string accountName, BinanceFuturesClient accountClient, int ordersPer10s);
+
+        std::string name;
+        BinanceFuturesClient client;
+        std::shared_ptr<RateLimiter> orderLimiter;
+    };
+
+    std::future<nlohmann::json> submit(AccountState& account, Operation operation);
+    void workerLoop();
+
+    Options options_;
+    std::shared_ptr<SharedTransport> transport_;
+    std::shared_ptr<RateLimiter> ipLimiter_;
+    std::vector<std::unique_ptr<AccountState>> accounts_;
+
+    std::mutex queueMutex_;
+    std::condition_variable queueReady_;
+    std::deque<std::function<void()>> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
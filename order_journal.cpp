@@ -0,0 +1,556 @@
+#include "order_journal.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+constexpr const char* kSegmentPrefix = "journal-";
+constexpr const char* kSegmentSuffix = ".bin";
+
+std::string segment_name(std::uint64_t index) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%s%08llu%s", kSegmentPrefix, static_cast<unsigned long long>(index), kSegmentSuffix);
+    return buffer;
+}
+
+bool parse_segment_index(const std::string& name, std::uint64_t& index) {
+    const std::string prefix = kSegmentPrefix;
+    const std::string suffix = kSegmentSuffix;
+    if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    const std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    if (digits.empty() || !std::all_of(digits.begin(), digits.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return false;
+    }
+    index = std::stoull(digits);
+    return true;
+}
+
+std::runtime_error system_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+constexpr std::size_t kRecordData = sizeof(JournalRecord::data);
+constexpr std::size_t kContinuationData = sizeof(JournalContinuation::data);
+
+template <std::size_t N>
+std::uint16_t copy_field(char (&field)[N], std::string_view value) {
+    const std::size_t length = std::min(value.size(), N);
+    std::memcpy(field, value.data(), length);
+    return static_cast<std::uint16_t>(length);
+}
+
+std::size_t continuations_for(std::size_t payloadBytes) {
+    return payloadBytes <= kRecordData ? 0 : (payloadBytes - kRecordData + kContinuationData - 1) / kContinuationData;
+}
+
+bool is_record(const JournalRecord& block) {
+    return block.sequence != 0 && block.chainIndex == 0;
+}
+
+// Walks the complete entries at the start of a segment. Returns the blocks
+// they take and sets `lastSequence` to the final entry's, or leaves it
+// untouched if there is none.
+std::size_t scan_entries(const JournalRecord* blocks, std::size_t count, std::uint64_t& lastSequence) {
+    std::size_t used = 0;
+    while (used < count && is_record(blocks[used]) && used + 1 + blocks[used].continuations <= count) {
+        lastSequence = blocks[used].sequence;
+        used += 1 + blocks[used].continuations;
+    }
+    return used;
+}
+
+// Sequence of the last complete entry in a segment file, or 0 if it has
+// none.
+std::uint64_t last_sequence(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw system_error("Failed to open journal segment", path);
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw system_error("Failed to stat journal segment", path);
+    }
+    const std::size_t bytes = static_cast<std::size_t>(info.st_size);
+    if (bytes < sizeof(JournalRecord)) {
+        ::close(fd);
+        return 0;
+    }
+    void* mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw system_error("Failed to map journal segment", path);
+    }
+    std::uint64_t sequence = 0;
+    scan_entries(static_cast<const JournalRecord*>(mapped), bytes / sizeof(JournalRecord), sequence);
+    munmap(mapped, bytes);
+    return sequence;
+}
+
+JournalRecord::Method method_code(std::string_view method) {
+    if (method == "GET") {
+        return JournalRecord::Method::GET;
+    }
+    if (method == "POST") {
+        return JournalRecord::Method::POST;
+    }
+    if (method == "DELETE") {
+        return JournalRecord::Method::DELETE;
+    }
+    if (method == "PUT") {
+        return JournalRecord::Method::PUT;
+    }
+    return JournalRecord::Method::OTHER;
+}
+
+const char* method_name(JournalRecord::Method method) {
+    switch (method) {
+        case JournalRecord::Method::GET:
+            return "GET";
+        case JournalRecord::Method::POST:
+            return "POST";
+        case JournalRecord::Method::DELETE:
+            return "DELETE";
+        case JournalRecord::Method::PUT:
+            return "PUT";
+        default:
+            return "OTHER";
+    }
+}
+
+}  // namespace
+
+class OrderJournal::SegmentWriter {
+public:
+    SegmentWriter(std::string directory, std::size_t segmentRecords)
+        : directory_(std::move(directory)),
+          segmentRecords_(segmentRecords) {
+        std::filesystem::create_directories(directory_);
+
+        std::vector<std::uint64_t> indices;
+        for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+            std::uint64_t index = 0;
+            if (entry.is_regular_file() && parse_segment_index(entry.path().filename().string(), index)) {
+                indices.push_back(index);
+            }
+        }
+        std::sort(indices.begin(), indices.end());
+        openSegment(indices.empty() ? 0 : indices.back());
+
+        // The newest segment has no entries if the process stopped right
+        // after rotating into it. Sequences then continue from the newest
+        // segment that has some.
+        for (std::size_t i = indices.size(); nextSequence_ == 1 && i > 1; --i) {
+            nextSequence_ = last_sequence(segmentPath(indices[i - 2])) + 1;
+        }
+    }
+
+    ~SegmentWriter() {
+        closeSegment();
+    }
+
+    // Blocks arrive in entry order. A record's sequence is set only once
+    // its last continuation is in place, so a torn entry reads as the end
+    // of the segment.
+    void append(const Block& block) {
+        if (remaining_ == 0) {
+            const std::size_t blocks = 1 + block.record.continuations;
+            if (used_ + blocks > capacity_) {
+                closeSegment();
+                openSegment(segmentIndex_ + 1);
+            }
+            head_ = used_;
+            entrySequence_ = nextSequence_++;
+            std::memcpy(&map_[used_++], &block, sizeof(Block));
+            remaining_ = block.record.continuations;
+        } else {
+            JournalRecord& target = map_[used_++];
+            std::memcpy(&target, &block, sizeof(Block));
+            target.sequence = entrySequence_;
+            --remaining_;
+        }
+        if (remaining_ == 0) {
+            std::atomic_thread_fence(std::memory_order_release);
+            map_[head_].sequence = entrySequence_;
+        }
+    }
+
+    void sync() {
+        if (map_) {
+            msync(map_, capacity_ * sizeof(JournalRecord), MS_ASYNC);
+        }
+    }
+
+private:
+    std::string segmentPath(std::uint64_t index) const {
+        return (std::filesystem::path(directory_) / segment_name(index)).string();
+    }
+
+    void openSegment(std::uint64_t index) {
+        const std::string path = segmentPath(index);
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) {
+            throw system_error("Failed to open journal segment", path);
+        }
+
+        struct stat info {};
+        if (fstat(fd_, &info) != 0) {
+            throw system_error("Failed to stat journal segment", path);
+        }
+        capacity_ = info.st_size == 0 ? segmentRecords_ : static_cast<std::size_t>(info.st_size) / sizeof(JournalRecord);
+        // Reserve the blocks up front. A sparse file would only find out the
+        // disk is full when a page is first written through the mapping,
+        // and that arrives as SIGBUS.
+        if (const int error = posix_fallocate(fd_, 0, static_cast<off_t>(capacity_ * sizeof(JournalRecord))); error != 0) {
+            errno = error;
+            throw system_error("Failed to allocate journal segment", path);
+        }
+
+        void* mapped = mmap(nullptr, capacity_ * sizeof(JournalRecord), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapped == MAP_FAILED) {
+            throw system_error("Failed to map journal segment", path);
+        }
+        map_ = static_cast<JournalRecord*>(mapped);
+        segmentIndex_ = index;
+
+        // Resume after the last complete entry of an existing segment.
+        std::uint64_t lastSequence = 0;
+        used_ = scan_entries(map_, capacity_, lastSequence);
+        if (lastSequence != 0) {
+            nextSequence_ = lastSequence + 1;
+        }
+        remaining_ = 0;
+    }
+
+    void closeSegment() {
+        if (map_) {
+            msync(map_, capacity_ * sizeof(JournalRecord), MS_SYNC);
+            munmap(map_, capacity_ * sizeof(JournalRecord));
+            map_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    std::string directory_;
+    std::size_t segmentRecords_;
+    std::size_t capacity_ = 0;
+    std::size_t used_ = 0;
+    std::size_t head_ = 0;
+    std::size_t remaining_ = 0;
+    std::uint64_t entrySequence_ = 0;
+    std::uint64_t segmentIndex_ = 0;
+    std::uint64_t nextSequence_ = 1;
+    int fd_ = -1;
+    JournalRecord* map_ = nullptr;
+};
+
+OrderJournal::OrderJournal(Options options)
+    : options_(std::move(options)) {
+    std::size_t capacity = 1;
+    while (capacity < options_.ringCapacity) {
+        capacity <<= 1;
+    }
+    slots_ = std::make_unique<Slot[]>(capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask_ = capacity - 1;
+
+    const std::size_t segmentRecords = std::max<std::size_t>(options_.segmentRecords, 1);
+    const std::size_t maxBlocks = std::min(capacity, segmentRecords);
+    maxEntryBytes_ = std::min(options_.maxEntryBytes, kRecordData + (maxBlocks - 1) * kContinuationData);
+
+    writer_ = std::make_unique<SegmentWriter>(options_.directory, segmentRecords);
+    thread_ = std::thread([this] { run(); });
+}
+
+OrderJournal::~OrderJournal() {
+    stop_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool OrderJournal::record(std::string_view method,
+                          std::string_view path,
+                          std::string_view request,
+                          std::string_view response,
+                          std::string_view clientOrderId,
+                          long httpStatus,
+                          int curlCode,
+                          std::int64_t sentAtNs,
+                          std::uint64_t latencyNs) {
+    if (failed_.load(std::memory_order_relaxed)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const std::string_view storedRequest = request.substr(0, maxEntryBytes_);
+    const std::string_view storedResponse = response.substr(0, maxEntryBytes_ - storedRequest.size());
+    const std::size_t continuations = continuations_for(storedRequest.size() + storedResponse.size());
+    const std::uint64_t blocks = 1 + continuations;
+
+    // Claims `blocks` consecutive slots. The writer frees slots in order, so
+    // the last one being free means every one before it is too.
+    std::uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;) {
+        const std::uint64_t last = pos + blocks - 1;
+        const std::uint64_t sequence = slots_[last & mask_].sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<std::int64_t>(sequence - last);
+        if (difference == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + blocks, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    JournalRecord& record = slots_[pos & mask_].block.record;
+    record.sequence = 0;
+    record.chainIndex = 0;
+    record.continuations = static_cast<std::uint32_t>(continuations);
+    record.sentAtNs = sentAtNs;
+    record.latencyNs = latencyNs;
+    record.httpStatus = static_cast<std::int32_t>(httpStatus);
+    record.curlCode = curlCode;
+    record.method = method_code(method);
+    record.reserved = 0;
+    record.pathLength = copy_field(record.path, path);
+    record.requestLength = static_cast<std::uint32_t>(storedRequest.size());
+    record.responseLength = static_cast<std::uint32_t>(storedResponse.size());
+    record.requestTotalLength = static_cast<std::uint32_t>(request.size());
+    record.responseTotalLength = static_cast<std::uint32_t>(response.size());
+    const std::uint16_t idLength = copy_field(record.clientOrderId, clientOrderId);
+    if (idLength < sizeof(record.clientOrderId)) {
+        record.clientOrderId[idLength] = '\0';
+    }
+
+    // Request then response, spilling from the record into continuations.
+    char* out = record.data;
+    std::size_t room = kRecordData;
+    std::uint64_t block = 0;
+    auto write = [&](std::string_view bytes) {
+        while (!bytes.empty()) {
+            if (room == 0) {
+                JournalContinuation& next = slots_[(pos + ++block) & mask_].block.continuation;
+                next.sequence = 0;
+                next.chainIndex = static_cast<std::uint32_t>(block);
+                next.reserved = 0;
+                out = next.data;
+                room = kContinuationData;
+            }
+            const std::size_t n = std::min(room, bytes.size());
+            std::memcpy(out, bytes.data(), n);
+            out += n;
+            room -= n;
+            bytes.remove_prefix(n);
+        }
+    };
+    write(storedRequest);
+    write(storedResponse);
+
+    for (std::uint64_t i = 0; i < blocks; ++i) {
+        slots_[(pos + i) & mask_].sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return true;
+}
+
+bool OrderJournal::drainOnce() {
+    bool any = false;
+    std::uint64_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = slots_[pos & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            break;
+        }
+        const bool isRecord = slot.block.record.chainIndex == 0;
+        if (failed_.load(std::memory_order_relaxed)) {
+            if (isRecord) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            writer_->append(slot.block);
+            if (isRecord) {
+                written_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        ++pos;
+        dequeuePos_.store(pos, std::memory_order_release);
+        any = true;
+    }
+    return any;
+}
+
+void OrderJournal::fail(const std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        error_ = error;
+    }
+    failed_.store(true, std::memory_order_release);
+}
+
+std::string OrderJournal::error() const {
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    return error_;
+}
+
+void OrderJournal::run() {
+    for (;;) {
+        const bool stopping = stop_.load(std::memory_order_acquire);
+        bool drained = false;
+        try {
+            drained = drainOnce();
+            if (!drained && !failed()) {
+                writer_->sync();
+            }
+        } catch (const std::exception& e) {
+            // The entry being written is dropped with everything after it;
+            // the slots are released so producers and flush() carry on.
+            fail(e.what());
+            continue;
+        }
+        if (drained) {
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+        std::this_thread::sleep_for(options_.idleSleep);
+    }
+    writer_.reset();
+}
+
+void OrderJournal::flush() {
+    const std::uint64_t target = enqueuePos_.load(std::memory_order_acquire);
+    while (dequeuePos_.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(options_.idleSleep);
+    }
+}
+
+JournalReader::JournalReader(std::string directory)
+    : directory_(std::move(directory)) {
+}
+
+std::vector<std::string> JournalReader::segments() const {
+    std::vector<std::pair<std::uint64_t, std::string>> indexed;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+        std::uint64_t index = 0;
+        if (entry.is_regular_file() && parse_segment_index(entry.path().filename().string(), index)) {
+            indexed.emplace_back(index, entry.path().string());
+        }
+    }
+    std::sort(indexed.begin(), indexed.end());
+
+    std::vector<std::string> paths;
+    paths.reserve(indexed.size());
+    for (auto& [index, path] : indexed) {
+        paths.push_back(std::move(path));
+    }
+    return paths;
+}
+
+void JournalReader::replay(const std::function<void(const JournalEntry&)>& callback) const {
+    std::string payload;
+    for (const auto& path : segments()) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw system_error("Failed to open journal segment", path);
+        }
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw system_error("Failed to stat journal segment", path);
+        }
+        const std::size_t bytes = static_cast<std::size_t>(info.st_size);
+        const std::size_t count = bytes / sizeof(JournalRecord);
+        if (count == 0) {
+            ::close(fd);
+            continue;
+        }
+        void* mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            throw system_error("Failed to map journal segment", path);
+        }
+
+        const auto* blocks = static_cast<const JournalRecord*>(mapped);
+        try {
+            std::size_t i = 0;
+            while (i < count && is_record(blocks[i])) {
+                const JournalRecord& record = blocks[i];
+                const std::size_t length = std::size_t{record.requestLength} + record.responseLength;
+                if (i + 1 + record.continuations > count || continuations_for(length) != record.continuations) {
+                    break;
+                }
+                payload.assign(record.data, std::min(length, kRecordData));
+                bool complete = true;
+                for (std::uint32_t k = 1; k <= record.continuations; ++k) {
+                    const auto& continuation = reinterpret_cast<const JournalContinuation&>(blocks[i + k]);
+                    if (continuation.sequence != record.sequence || continuation.chainIndex != k) {
+                        complete = false;
+                        break;
+                    }
+                    payload.append(continuation.data, std::min(length - payload.size(), kContinuationData));
+                }
+                if (!complete) {
+                    break;
+                }
+                const std::string_view view(payload);
+                callback(JournalEntry{record, view.substr(0, record.requestLength), view.substr(record.requestLength)});
+                i += 1 + record.continuations;
+            }
+        } catch (...) {
+            munmap(mapped, bytes);
+            throw;
+        }
+        munmap(mapped, bytes);
+    }
+}
+
+json JournalReader::toJson(const JournalEntry& entry) {
+    const JournalRecord& record = entry.record;
+    json result{
+        {"sequence", record.sequence},
+        {"sentAtNs", record.sentAtNs},
+        {"latencyNs", record.latencyNs},
+        {"httpStatus", record.httpStatus},
+        {"curlCode", record.curlCode},
+        {"method", method_name(record.method)},
+        {"path", std::string(record.path, std::min<std::size_t>(record.pathLength, sizeof(record.path)))},
+        {"request", std::string(entry.request)},
+        {"response", std::string(entry.response)}
+    };
+    const std::string_view clientOrderId(record.clientOrderId, strnlen(record.clientOrderId, sizeof(record.clientOrderId)));
+    if (!clientOrderId.empty()) {
+        result["clientOrderId"] = std::string(clientOrderId);
+    }
+    if (record.requestTotalLength > record.requestLength || record.responseTotalLength > record.responseLength) {
+        result["truncated"] = true;
+    }
+    return result;
+}
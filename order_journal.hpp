@@ -0,0 +1,153 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// On-disk layout. Segments are arrays of fixed 1 KiB blocks so they can be
+// indexed directly. An entry is one JournalRecord followed by
+// `continuations` JournalContinuation blocks; the request and then the
+// response bytes run from the record's `data` on through each
+// continuation's. Payloads past OrderJournal::Options::maxEntryBytes are
+// truncated and their original lengths kept alongside.
+struct JournalRecord {
+    enum class Method : std::uint8_t { GET, POST, DELETE, PUT, OTHER };
+
+    std::uint64_t sequence;
+    // 0 for the record; continuations count up from 1.
+    std::uint32_t chainIndex;
+    std::uint32_t continuations;
+    std::int64_t sentAtNs;
+    std::uint64_t latencyNs;
+    std::int32_t httpStatus;
+    std::int32_t curlCode;
+    Method method;
+    std::uint8_t reserved;
+    std::uint16_t pathLength;
+    std::uint32_t requestLength;
+    std::uint32_t responseLength;
+    std::uint32_t requestTotalLength;
+    std::uint32_t responseTotalLength;
+    char clientOrderId[40];
+    char path[40];
+    char data[884];
+};
+
+// Carries the same sequence as the record it continues.
+struct JournalContinuation {
+    std::uint64_t sequence;
+    std::uint32_t chainIndex;
+    std::uint32_t reserved;
+    char data[1008];
+};
+
+static_assert(sizeof(JournalRecord) == 1024, "JournalRecord layout must stay fixed");
+static_assert(sizeof(JournalContinuation) == sizeof(JournalRecord), "Journal blocks must share one size");
+
+// A replayed entry with its payloads reassembled.
+struct JournalEntry {
+    const JournalRecord& record;
+    std::string_view request;
+    std::string_view response;
+};
+
+class OrderJournal {
+public:
+    struct Options {
+        std::string directory;
+        // In 1 KiB blocks; an entry takes as many as its payloads need.
+        std::size_t ringCapacity = 256;
+        std::size_t segmentRecords = 65536;
+        // Request plus response bytes kept per entry; also capped so an
+        // entry fits in the ring and in one segment.
+        std::size_t maxEntryBytes = 64 * 1024;
+        std::chrono::microseconds idleSleep{200};
+    };
+
+    explicit OrderJournal(Options options);
+    ~OrderJournal();
+
+    OrderJournal(const OrderJournal&) = delete;
+    OrderJournal& operator=(const OrderJournal&) = delete;
+
+    // Copies the entry into the ring and returns immediately. Never blocks:
+    // when the ring is full, or the journal has failed, the entry is dropped
+    // and counted.
+    bool record(std::string_view method,
+                std::string_view path,
+                std::string_view request,
+                std::string_view response,
+                std::string_view clientOrderId,
+                long httpStatus,
+                int curlCode,
+                std::int64_t sentAtNs,
+                std::uint64_t latencyNs);
+
+    // Blocks until everything recorded so far has reached the segment files.
+    void flush();
+
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    std::uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+    // Set once a segment could not be created or written, e.g. on a full
+    // disk. Every entry from then on is dropped; the process keeps running.
+    bool failed() const { return failed_.load(std::memory_order_acquire); }
+    std::string error() const;
+
+private:
+    union Block {
+        JournalRecord record;
+        JournalContinuation continuation;
+    };
+
+    struct Slot {
+        std::atomic<std::uint64_t> sequence;
+        Block block;
+    };
+
+    class SegmentWriter;
+
+    void run();
+    bool drainOnce();
+    void fail(const std::string& error);
+
+    Options options_;
+    std::unique_ptr<Slot[]> slots_;
+    std::uint64_t mask_;
+    std::size_t maxEntryBytes_;
+    alignas(64) std::atomic<std::uint64_t> enqueuePos_{0};
+    alignas(64) std::atomic<std::uint64_t> dequeuePos_{0};
+    alignas(64) std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> failed_{false};
+    mutable std::mutex errorMutex_;
+    std::string error_;
+    std::unique_ptr<SegmentWriter> writer_;
+    std::thread thread_;
+};
+
+class JournalReader {
+public:
+    explicit JournalReader(std::string directory);
+
+    // Stops at the first incomplete entry of each segment.
+    void replay(const std::function<void(const JournalEntry&)>& callback) const;
+
+    static nlohmann::json toJson(const JournalEntry& entry);
+
+private:
+    std::vector<std::string> segments() const;
+
+    std::string directory_;
+};
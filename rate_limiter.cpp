@@ -0,0 +1,77 @@
+#include "rate_limiter.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+std::int64_t to_ms(RateLimiter::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+}  // namespace
+
+RateLimiter::RateLimiter(int capacity, std::chrono::milliseconds window)
+    : capacity_(capacity),
+      windowMs_(window.count()) {
+    if (capacity <= 0 || window.count() <= 0) {
+        throw std::runtime_error("Rate limiter capacity and window must be positive");
+    }
+    roll(nowMs());
+}
+
+std::int64_t RateLimiter::nowMs() {
+    return to_ms(Clock::now());
+}
+
+void RateLimiter::roll(std::int64_t now) {
+    const std::int64_t start = now - now % windowMs_;
+    if (start != windowStart_) {
+        windowStart_ = start;
+        used_ = 0;
+    }
+}
+
+bool RateLimiter::tryAcquire(int weight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    roll(nowMs());
+    if (used_ + weight > capacity_) {
+        return false;
+    }
+    used_ += weight;
+    return true;
+}
+
+void RateLimiter::acquire(int weight) {
+    if (weight > capacity_) {
+        throw std::runtime_error("Request weight exceeds rate limit capacity");
+    }
+    for (;;) {
+        std::int64_t waitMs = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const std::int64_t now = nowMs();
+            roll(now);
+            if (used_ + weight <= capacity_) {
+                used_ += weight;
+                return;
+            }
+            waitMs = windowStart_ + windowMs_ - now;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::max<std::int64_t>(waitMs, 1)));
+    }
+}
+
+void RateLimiter::sync(int used, Clock::time_point sentAt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    roll(nowMs());
+    const std::int64_t sent = to_ms(sentAt);
+    if (sent - sent % windowMs_ == windowStart_) {
+        used_ = std::max(used_, used);
+    }
+}
+
+int RateLimiter::used() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::int64_t now = nowMs();
+    return now - now % windowMs_ == windowStart_ ? used_ : 0;
+}
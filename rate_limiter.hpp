@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Fixed-window counter aligned to the wall clock, matching how the exchange
+// counts request weight (per calendar minute) and order counts (per 10 s
+// and per minute). A window never admits more than `capacity`, however the
+// requests are spread across its boundary.
+class RateLimiter {
+public:
+    using Clock = std::chrono::system_clock;
+
+    RateLimiter(int capacity, std::chrono::milliseconds window);
+
+    // Blocks until `weight` fits in the current window, then takes it.
+    void acquire(int weight);
+
+    bool tryAcquire(int weight);
+
+    // Raises the count for the window containing `sentAt` to `used`, as
+    // reported by the exchange's X-MBX-USED-WEIGHT-* or X-MBX-ORDER-COUNT-*
+    // headers. Never lowers it, and ignores reports for a window that has
+    // already rolled over.
+    void sync(int used, Clock::time_point sentAt);
+
+    int used() const;
+
+private:
+    static std::int64_t nowMs();
+    void roll(std::int64_t nowMs);
+
+    mutable std::mutex mutex_;
+    int capacity_;
+    std::int64_t windowMs_;
+    std::int64_t windowStart_ = 0;
+    int used_ = 0;
+};
@@ -0,0 +1,220 @@
+#include "request_metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+std::string endpoint_label(std::size_t index) {
+    const endpoints::EndpointInfo& endpoint = endpoints::kEndpoints[index];
+    const std::string_view method = endpoints::method_name(endpoint.method);
+    std::string label;
+    label.reserve(method.size() + 1 + endpoint.path.size());
+    label.append(method);
+    label.push_back(' ');
+    label.append(endpoint.path);
+    return label;
+}
+
+std::string prometheus_escape(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+double to_micros(std::uint64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+}  // namespace
+
+std::size_t LatencyHistogram::bucketFor(std::uint64_t valueNs) {
+    if (valueNs < kSubBucketCount) {
+        return static_cast<std::size_t>(valueNs);
+    }
+    const unsigned msb = 63U - static_cast<unsigned>(__builtin_clzll(valueNs));
+    const unsigned shift = msb - (kSubBucketBits - 1);
+    if (shift > kMaxShift) {
+        return kBucketCount - 1;
+    }
+    const std::uint64_t top = valueNs >> shift;
+    return static_cast<std::size_t>(kSubBucketCount + (shift - 1) * kHalfSubBucketCount + (top - kHalfSubBucketCount));
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(std::size_t index) {
+    if (index < kSubBucketCount) {
+        return index;
+    }
+    const std::uint64_t offset = index - kSubBucketCount;
+    const unsigned shift = static_cast<unsigned>(offset / kHalfSubBucketCount) + 1;
+    const std::uint64_t top = offset % kHalfSubBucketCount + kHalfSubBucketCount;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t valueNs) {
+    buckets_[bucketFor(valueNs)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(valueNs, std::memory_order_relaxed);
+    std::uint64_t current = max_.load(std::memory_order_relaxed);
+    while (valueNs > current && !max_.compare_exchange_weak(current, valueNs, std::memory_order_relaxed)) {
+    }
+}
+
+std::uint64_t LatencyHistogram::percentile(double quantile) const {
+    const std::uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    const auto target = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(quantile * static_cast<double>(total))));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            return std::min(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+const char* RequestMetrics::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::ENCODE:
+            return "encode";
+        case Stage::SIGN:
+            return "sign";
+        case Stage::NAME_LOOKUP:
+            return "name_lookup";
+        case Stage::CONNECT:
+            return "connect";
+        case Stage::TLS:
+            return "tls";
+        case Stage::TTFB:
+            return "ttfb";
+        case Stage::TRANSFER:
+            return "transfer";
+        case Stage::PARSE:
+            return "parse";
+        case Stage::TOTAL:
+            return "total";
+        default:
+            return "unknown";
+    }
+}
+
+bool RequestMetrics::EndpointStats::empty() const {
+    if (errors.load(std::memory_order_relaxed) != 0) {
+        return false;
+    }
+    return std::all_of(stages.begin(), stages.end(), [](const LatencyHistogram& histogram) { return histogram.count() == 0; });
+}
+
+void RequestMetrics::record(const Trace& trace) {
+    const auto index = static_cast<std::size_t>(trace.endpoint);
+    if (index < kEndpointCount) {
+        EndpointStats& stats = endpoints_[index];
+        for (std::size_t i = 0; i < kStageCount; ++i) {
+            if (trace.stageNs[i] >= 0) {
+                stats.stages[i].record(static_cast<std::uint64_t>(trace.stageNs[i]));
+            }
+        }
+        if (trace.httpStatus == 0 || trace.httpStatus >= 400) {
+            stats.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (auto observer = std::atomic_load(&observer_)) {
+        (*observer)(trace);
+    }
+}
+
+void RequestMetrics::setObserver(Observer observer) {
+    std::shared_ptr<const Observer> next;
+    if (observer) {
+        next = std::make_shared<const Observer>(std::move(observer));
+    }
+    std::atomic_store(&observer_, std::move(next));
+}
+
+json RequestMetrics::toJson() const {
+    json result = json::object();
+    for (std::size_t e = 0; e < kEndpointCount; ++e) {
+        const EndpointStats& stats = endpoints_[e];
+        if (stats.empty()) {
+            continue;
+        }
+        json endpointJson;
+        endpointJson["errors"] = stats.errors.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < kStageCount; ++i) {
+            const LatencyHistogram& histogram = stats.stages[i];
+            const std::uint64_t count = histogram.count();
+            if (count == 0) {
+                continue;
+            }
+            json stageJson{
+                {"count", count},
+                {"meanUs", to_micros(histogram.sum()) / static_cast<double>(count)},
+                {"p50Us", to_micros(histogram.percentile(0.5))},
+                {"p90Us", to_micros(histogram.percentile(0.9))},
+                {"p99Us", to_micros(histogram.percentile(0.99))},
+                {"p999Us", to_micros(histogram.percentile(0.999))},
+                {"maxUs", to_micros(histogram.max())}
+            };
+            endpointJson["stages"][stageName(static_cast<Stage>(i))] = std::move(stageJson);
+        }
+        result[endpoint_label(e)] = std::move(endpointJson);
+    }
+    return result;
+}
+
+std::string RequestMetrics::toPrometheus() const {
+    std::ostringstream out;
+    out << std::setprecision(9);
+    out << "# HELP binance_request_stage_seconds Per-stage latency of Binance REST requests.\n"
+        << "# TYPE binance_request_stage_seconds summary\n";
+
+    std::vector<std::pair<std::string, const EndpointStats*>> sorted;
+    for (std::size_t e = 0; e < kEndpointCount; ++e) {
+        if (!endpoints_[e].empty()) {
+            sorted.emplace_back(endpoint_label(e), &endpoints_[e]);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    for (const auto& [key, stats] : sorted) {
+        const std::string endpointLabel = "endpoint=\"" + prometheus_escape(key) + "\"";
+        for (std::size_t i = 0; i < kStageCount; ++i) {
+            const LatencyHistogram& histogram = stats->stages[i];
+            if (histogram.count() == 0) {
+                continue;
+            }
+            const std::string labels = endpointLabel + ",stage=\"" + stageName(static_cast<Stage>(i)) + "\"";
+            for (double quantile : kQuantiles) {
+                out << "binance_request_stage_seconds{" << labels << ",quantile=\"" << quantile << "\"} "
+                    << static_cast<double>(histogram.percentile(quantile)) / 1e9 << '\n';
+            }
+            out << "binance_request_stage_seconds_sum{" << labels << "} " << static_cast<double>(histogram.sum()) / 1e9 << '\n';
+            out << "binance_request_stage_seconds_count{" << labels << "} " << histogram.count() << '\n';
+        }
+    }
+
+    out << "# HELP binance_request_errors_total Requests that failed at transport level or returned HTTP >= 400.\n"
+        << "# TYPE binance_request_errors_total counter\n";
+    for (const auto& [key, stats] : sorted) {
+        out << "binance_request_errors_total{endpoint=\"" << prometheus_escape(key) << "\"} "
+            << stats->errors.load(std::memory_order_relaxed) << '\n';
+    }
+    return out.str();
+}
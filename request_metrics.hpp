@@ -0,0 +1,97 @@
+#pragma once
+
+#include "binance_endpoints.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Log-linear histogram of nanosecond values in the spirit of HdrHistogram:
+// 32 linear buckets per power of two, roughly 3% relative precision.
+// Recording is wait-free; reads are relaxed snapshots.
+class LatencyHistogram {
+public:
+    void record(std::uint64_t valueNs);
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    std::uint64_t percentile(double quantile) const;
+
+private:
+    static constexpr unsigned kSubBucketBits = 6;
+    static constexpr std::uint64_t kSubBucketCount = 1ULL << kSubBucketBits;
+    static constexpr std::uint64_t kHalfSubBucketCount = kSubBucketCount / 2;
+    static constexpr unsigned kMaxShift = 36;
+    static constexpr std::size_t kBucketCount = kSubBucketCount + kMaxShift * kHalfSubBucketCount;
+
+    static std::size_t bucketFor(std::uint64_t valueNs);
+    static std::uint64_t bucketUpperBound(std::size_t index);
+
+    std::array<std::atomic<std::uint64_t>, kBucketCount> buckets_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+class RequestMetrics {
+public:
+    enum class Stage {
+        ENCODE,
+        SIGN,
+        NAME_LOOKUP,
+        CONNECT,
+        TLS,
+        TTFB,
+        TRANSFER,
+        PARSE,
+        TOTAL
+    };
+
+    static constexpr std::size_t kStageCount = static_cast<std::size_t>(Stage::TOTAL) + 1;
+
+    struct Trace {
+        endpoints::EndpointId endpoint = endpoints::EndpointId::COUNT;
+        long httpStatus = 0;
+        // Nanoseconds per stage; negative when the stage did not run.
+        std::array<std::int64_t, kStageCount> stageNs;
+
+        Trace() { stageNs.fill(-1); }
+        void set(Stage stage, std::int64_t ns) { stageNs[static_cast<std::size_t>(stage)] = ns; }
+    };
+
+    using Observer = std::function<void(const Trace&)>;
+
+    // Lock- and allocation-free: stats are indexed by trace.endpoint.
+    void record(const Trace& trace);
+
+    // Invoked synchronously after every recorded request.
+    void setObserver(Observer observer);
+
+    nlohmann::json toJson() const;
+    std::string toPrometheus() const;
+
+    static const char* stageName(Stage stage);
+
+private:
+    struct EndpointStats {
+        std::array<LatencyHistogram, kStageCount> stages;
+        std::atomic<std::uint64_t> errors{0};
+
+        bool empty() const;
+    };
+
+    static constexpr std::size_t kEndpointCount = static_cast<std::size_t>(endpoints::EndpointId::COUNT);
+
+    // One slot per endpoint descriptor; endpoints never called are left out
+    // of the dumps, which label them "METHOD /path".
+    std::array<EndpointStats, kEndpointCount> endpoints_;
+    std::shared_ptr<const Observer> observer_;
+};
@@ -0,0 +1,484 @@
+#include "risk_engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double number_field(const json& object, const char* key, double fallback = 0.0) {
+    auto it = object.find(key);
+    if (it == object.end() || it->is_null()) {
+        return fallback;
+    }
+    if (it->is_string()) {
+        const std::string& text = it->get_ref<const std::string&>();
+        return text.empty() ? fallback : std::stod(text);
+    }
+    return it->get<double>();
+}
+
+std::string position_key(const std::string& symbol, const std::string& positionSide) {
+    return symbol + '/' + positionSide;
+}
+
+double liquidation_distance(double mark, double liquidation) {
+    return liquidation > 0.0 && mark > 0.0 ? std::fabs(mark - liquidation) / mark
+                                           : std::numeric_limits<double>::infinity();
+}
+}  // namespace
+
+RiskEngine::RiskEngine()
+    : RiskEngine(Options{}) {
+}
+
+RiskEngine::RiskEngine(Options options)
+    : options_(options) {
+}
+
+RiskEngine::AccountId RiskEngine::addAccount(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AccountState account;
+    account.name = name;
+    account.begin = account.end = qty_.size();
+    accounts_.push_back(std::move(account));
+    return static_cast<AccountId>(accounts_.size() - 1);
+}
+
+std::string RiskEngine::accountName(AccountId account) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return accounts_.at(account).name;
+}
+
+RiskEngine::SymbolId RiskEngine::symbolId(const std::string& symbol) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return internLocked(symbol);
+}
+
+RiskEngine::SymbolId RiskEngine::internLocked(const std::string& symbol) {
+    auto [it, inserted] = symbolIds_.emplace(symbol, static_cast<SymbolId>(symbolNames_.size()));
+    if (inserted) {
+        symbolNames_.push_back(symbol);
+        lastMark_.push_back(0.0);
+        symbolRows_.emplace_back();
+        symbolAccounts_.emplace_back();
+    }
+    return it->second;
+}
+
+std::string RiskEngine::symbolName(SymbolId symbol) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return symbolNames_.at(symbol);
+}
+
+void RiskEngine::seed(AccountId id, const json& accountInfo, const json& positionRisk) {
+    if (!positionRisk.is_array()) {
+        throw std::runtime_error("positionRisk payload must be an array");
+    }
+
+    // Maintenance margin per position as the exchange reports it; dividing
+    // by notional gives the effective rate of that position's bracket.
+    std::unordered_map<std::string, double> maintMargins;
+    if (auto it = accountInfo.find("positions"); it != accountInfo.end() && it->is_array()) {
+        for (const auto& position : *it) {
+            maintMargins[position_key(position.value("symbol", ""), position.value("positionSide", "BOTH"))] =
+                number_field(position, "maintMargin");
+        }
+    }
+    const double wallet = number_field(accountInfo, "totalCrossWalletBalance", number_field(accountInfo, "totalWalletBalance"));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= accounts_.size()) {
+        throw std::runtime_error("Unknown risk account id: " + std::to_string(id));
+    }
+
+    std::vector<Row> seeded;
+    for (const auto& position : positionRisk) {
+        const double qty = number_field(position, "positionAmt");
+        if (qty == 0.0) {
+            continue;
+        }
+        const std::string symbol = position.value("symbol", "");
+        Row row;
+        row.symbol = internLocked(symbol);
+        row.qty = qty;
+        row.entry = number_field(position, "entryPrice");
+        row.mark = lastMark_[row.symbol] > 0.0 ? lastMark_[row.symbol] : number_field(position, "markPrice", row.entry);
+        const bool isolated = position.value("marginType", "cross") == "isolated";
+        row.cross = isolated ? 0.0 : 1.0;
+        row.isolatedWallet = isolated ? number_field(position, "isolatedWallet", number_field(position, "isolatedMargin")) : 0.0;
+
+        const double notional = std::fabs(qty) * number_field(position, "markPrice", row.mark);
+        auto maint = maintMargins.find(position_key(symbol, position.value("positionSide", "BOTH")));
+        row.maintRate = maint != maintMargins.end() && maint->second > 0.0 && notional > 0.0
+                            ? maint->second / notional
+                            : options_.defaultMaintenanceRate;
+        seeded.push_back(row);
+    }
+
+    // Rebuild the table with this account's rows swapped out. Seeding is rare
+    // next to ticks, so a full copy keeps every account contiguous.
+    const std::size_t oldSize = qty_.size();
+    const AccountState& target = accounts_[id];
+    const std::size_t removed = target.end - target.begin;
+    const std::size_t newSize = oldSize - removed + seeded.size();
+
+    std::vector<AccountId> owner;
+    std::vector<SymbolId> symbol;
+    std::vector<double> qty, entry, mark, maintRate, cross, isolatedWallet;
+    std::vector<unsigned char> alerted;
+    owner.reserve(newSize);
+    symbol.reserve(newSize);
+    qty.reserve(newSize);
+    entry.reserve(newSize);
+    mark.reserve(newSize);
+    maintRate.reserve(newSize);
+    cross.reserve(newSize);
+    isolatedWallet.reserve(newSize);
+    alerted.reserve(newSize);
+
+    for (AccountId a = 0; a < accounts_.size(); ++a) {
+        AccountState& account = accounts_[a];
+        const std::size_t begin = qty.size();
+        if (a == id) {
+            for (const auto& row : seeded) {
+                owner.push_back(a);
+                symbol.push_back(row.symbol);
+                qty.push_back(row.qty);
+                entry.push_back(row.entry);
+                mark.push_back(row.mark);
+                maintRate.push_back(row.maintRate);
+                cross.push_back(row.cross);
+                isolatedWallet.push_back(row.isolatedWallet);
+                alerted.push_back(0);
+            }
+            account.wallet = wallet;
+            account.ratioAlerted = false;
+        } else {
+            for (std::size_t i = account.begin; i < account.end; ++i) {
+                owner.push_back(a);
+                symbol.push_back(symbol_[i]);
+                qty.push_back(qty_[i]);
+                entry.push_back(entry_[i]);
+                mark.push_back(mark_[i]);
+                maintRate.push_back(maintRate_[i]);
+                cross.push_back(cross_[i]);
+                isolatedWallet.push_back(isolatedWallet_[i]);
+                alerted.push_back(liquidationAlerted_[i]);
+            }
+        }
+        account.begin = begin;
+        account.end = qty.size();
+    }
+
+    owner_ = std::move(owner);
+    symbol_ = std::move(symbol);
+    qty_ = std::move(qty);
+    entry_ = std::move(entry);
+    mark_ = std::move(mark);
+    maintRate_ = std::move(maintRate);
+    cross_ = std::move(cross);
+    isolatedWallet_ = std::move(isolatedWallet);
+    unrealized_.assign(newSize, 0.0);
+    maint_.assign(newSize, 0.0);
+    inverseSlope_.assign(newSize, 0.0);
+    offset_.assign(newSize, 0.0);
+    trigger_.assign(newSize, 0.0);
+    liquidationAlerted_ = std::move(alerted);
+
+    rebuildIndex();
+    for (auto& account : accounts_) {
+        recompute(account);
+    }
+}
+
+void RiskEngine::rebuildIndex() {
+    for (auto& rows : symbolRows_) {
+        rows.clear();
+    }
+    for (auto& accounts : symbolAccounts_) {
+        accounts.clear();
+    }
+    for (AccountId a = 0; a < accounts_.size(); ++a) {
+        for (std::size_t i = accounts_[a].begin; i < accounts_[a].end; ++i) {
+            symbolRows_[symbol_[i]].push_back(static_cast<std::uint32_t>(i));
+            auto& holders = symbolAccounts_[symbol_[i]];
+            if (holders.empty() || holders.back() != a) {
+                holders.push_back(a);
+            }
+        }
+    }
+}
+
+void RiskEngine::updateRows(std::size_t begin, std::size_t end) {
+    const double* qty = qty_.data();
+    const double* entry = entry_.data();
+    const double* mark = mark_.data();
+    const double* maintRate = maintRate_.data();
+    const double* cross = cross_.data();
+    const double* isolatedWallet = isolatedWallet_.data();
+    double* unrealized = unrealized_.data();
+    double* maint = maint_.data();
+    double* inverseSlope = inverseSlope_.data();
+    double* offset = offset_.data();
+    double* trigger = trigger_.data();
+    const double distance = liquidationThreshold_;
+
+    // Liquidation is where margin balance meets maintenance margin. A cross
+    // row is backed by the account's headroom minus its own contribution to
+    // it, an isolated row by its own wallet only. Solving for the mark gives
+    // (backing - qty * entry) / (|qty| * maintRate - qty).
+    for (std::size_t i = begin; i < end; ++i) {
+        unrealized[i] = qty[i] * (mark[i] - entry[i]);
+        maint[i] = std::fabs(qty[i]) * mark[i] * maintRate[i];
+        const double slope = std::fabs(qty[i]) * maintRate[i] - qty[i];
+        inverseSlope[i] = 1.0 / slope;
+        offset[i] = (1.0 - cross[i]) * isolatedWallet[i] - cross[i] * (unrealized[i] - maint[i]) - qty[i] * entry[i];
+        // Within `distance` of liquidation once the price reaches
+        // mark * (1 -/+ distance); slope's sign flips the inequality for
+        // longs and shorts alike, leaving one comparison against headroom.
+        const double side = qty[i] > 0.0 ? 1.0 : -1.0;
+        trigger[i] = mark[i] * (1.0 - side * distance) * slope - offset[i];
+    }
+}
+
+void RiskEngine::updateRow(std::size_t row) {
+    updateRows(row, row + 1);
+}
+
+double RiskEngine::liquidationPrice(std::size_t row) const {
+    const double headroom = accounts_[owner_[row]].headroom();
+    return std::max((cross_[row] * headroom + offset_[row]) * inverseSlope_[row], 0.0);
+}
+
+double RiskEngine::AccountState::marginRatio() const {
+    const double marginBalance = wallet + crossUnrealized;
+    return marginBalance > 0.0 ? crossMaint / marginBalance : std::numeric_limits<double>::infinity();
+}
+
+void RiskEngine::recompute(AccountState& account) {
+    updateRows(account.begin, account.end);
+
+    double crossUnrealized = 0.0;
+    double crossMaint = 0.0;
+    for (std::size_t i = account.begin; i < account.end; ++i) {
+        crossUnrealized += cross_[i] * unrealized_[i];
+        crossMaint += cross_[i] * maint_[i];
+    }
+    // Ticks apply deltas to these sums; recomputing them here also sheds any
+    // rounding drift those accumulated.
+    account.crossUnrealized = crossUnrealized;
+    account.crossMaint = crossMaint;
+    account.armedMax = std::numeric_limits<double>::infinity();
+    account.alertedMin = -std::numeric_limits<double>::infinity();
+}
+
+void RiskEngine::scanLiquidation(AccountId id, std::vector<Alert>& alerts) {
+    AccountState& account = accounts_[id];
+    const double headroom = account.headroom();
+    double armedMax = -std::numeric_limits<double>::infinity();
+    double alertedMin = std::numeric_limits<double>::infinity();
+    for (std::size_t i = account.begin; i < account.end; ++i) {
+        if (cross_[i] == 0.0) {
+            continue;
+        }
+        const bool breached = headroom <= trigger_[i];
+        if (breached && !liquidationAlerted_[i]) {
+            alerts.push_back({AlertKind::LIQUIDATION_DISTANCE, id, symbol_[i],
+                              liquidation_distance(mark_[i], liquidationPrice(i)), liquidationThreshold_, 0});
+        }
+        liquidationAlerted_[i] = breached;
+        if (breached) {
+            alertedMin = std::min(alertedMin, trigger_[i]);
+        } else {
+            armedMax = std::max(armedMax, trigger_[i]);
+        }
+    }
+    account.armedMax = armedMax;
+    account.alertedMin = alertedMin;
+}
+
+void RiskEngine::evaluate(AccountId id, SymbolId ticked, std::vector<Alert>& alerts) {
+    AccountState& account = accounts_[id];
+    if (marginRatioCallback_) {
+        const double ratio = account.marginRatio();
+        const bool breached = ratio >= marginRatioThreshold_;
+        if (breached && !account.ratioAlerted) {
+            alerts.push_back({AlertKind::MARGIN_RATIO, id, ticked, ratio, marginRatioThreshold_, 0});
+        }
+        account.ratioAlerted = breached;
+    }
+    if (liquidationCallback_) {
+        const double headroom = account.headroom();
+        if (headroom <= account.armedMax || headroom > account.alertedMin) {
+            scanLiquidation(id, alerts);
+        }
+    }
+}
+
+void RiskEngine::onMarginRatio(double ratio, AlertCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    marginRatioThreshold_ = ratio;
+    marginRatioCallback_ = std::move(callback);
+}
+
+void RiskEngine::onLiquidationDistance(double fraction, AlertCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    liquidationThreshold_ = fraction;
+    liquidationCallback_ = std::move(callback);
+    // Triggers depend on the distance; the next tick rescans every account.
+    for (auto& account : accounts_) {
+        recompute(account);
+    }
+}
+
+void RiskEngine::onMarkPrice(SymbolId symbol, double markPrice) {
+    const auto received = Clock::now();
+    std::vector<Alert> alerts;
+    AlertCallback marginRatioCallback;
+    AlertCallback liquidationCallback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (symbol >= lastMark_.size()) {
+            return;
+        }
+        lastMark_[symbol] = markPrice;
+        for (std::uint32_t row : symbolRows_[symbol]) {
+            const double previousUnrealized = unrealized_[row];
+            const double previousMaint = maint_[row];
+            mark_[row] = markPrice;
+            updateRow(row);
+
+            AccountState& account = accounts_[owner_[row]];
+            account.crossUnrealized += cross_[row] * (unrealized_[row] - previousUnrealized);
+            account.crossMaint += cross_[row] * (maint_[row] - previousMaint);
+            if (cross_[row] == 0.0) {
+                // An isolated row's distance depends on nothing but its own mark.
+                const bool breached = liquidationCallback_ && trigger_[row] >= 0.0;
+                if (breached && !liquidationAlerted_[row]) {
+                    alerts.push_back({AlertKind::LIQUIDATION_DISTANCE, owner_[row], symbol,
+                                      liquidation_distance(markPrice, liquidationPrice(row)), liquidationThreshold_, 0});
+                }
+                liquidationAlerted_[row] = breached;
+            } else if (liquidationAlerted_[row]) {
+                account.alertedMin = std::min(account.alertedMin, trigger_[row]);
+            } else {
+                account.armedMax = std::max(account.armedMax, trigger_[row]);
+            }
+        }
+        for (AccountId id : symbolAccounts_[symbol]) {
+            evaluate(id, symbol, alerts);
+        }
+        if (alerts.empty()) {
+            return;
+        }
+        marginRatioCallback = marginRatioCallback_;
+        liquidationCallback = liquidationCallback_;
+    }
+
+    for (auto& alert : alerts) {
+        alert.latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - received).count();
+        if (alert.kind == AlertKind::MARGIN_RATIO) {
+            marginRatioCallback(alert);
+        } else {
+            liquidationCallback(alert);
+        }
+    }
+}
+
+void RiskEngine::onMarkPrice(const std::string& symbol, double markPrice) {
+    SymbolId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = symbolIds_.find(symbol);
+        if (it == symbolIds_.end()) {
+            return;
+        }
+        id = it->second;
+    }
+    onMarkPrice(id, markPrice);
+}
+
+RiskEngine::AccountRisk RiskEngine::account(AccountId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return accountLocked(id);
+}
+
+std::vector<RiskEngine::PositionRisk> RiskEngine::positions(AccountId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return positionsLocked(id);
+}
+
+RiskEngine::AccountRisk RiskEngine::accountLocked(AccountId id) const {
+    const AccountState& account = accounts_.at(id);
+    AccountRisk risk;
+    risk.walletBalance = account.wallet;
+    for (std::size_t i = account.begin; i < account.end; ++i) {
+        risk.unrealizedProfit += unrealized_[i];
+    }
+    risk.marginBalance = account.wallet + account.crossUnrealized;
+    risk.maintMargin = account.crossMaint;
+    risk.marginRatio = account.marginRatio();
+    return risk;
+}
+
+std::vector<RiskEngine::PositionRisk> RiskEngine::positionsLocked(AccountId id) const {
+    const AccountState& account = accounts_.at(id);
+    std::vector<PositionRisk> result;
+    result.reserve(account.end - account.begin);
+    for (std::size_t i = account.begin; i < account.end; ++i) {
+        PositionRisk position;
+        position.symbol = symbolNames_[symbol_[i]];
+        position.isolated = cross_[i] == 0.0;
+        position.positionAmt = qty_[i];
+        position.entryPrice = entry_[i];
+        position.markPrice = mark_[i];
+        position.unrealizedProfit = unrealized_[i];
+        position.maintMargin = maint_[i];
+        position.liquidationPrice = liquidationPrice(i);
+        result.push_back(std::move(position));
+    }
+    return result;
+}
+
+std::size_t RiskEngine::positionCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return qty_.size();
+}
+
+json RiskEngine::toJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json accounts = json::array();
+    for (AccountId id = 0; id < accounts_.size(); ++id) {
+        const AccountRisk risk = accountLocked(id);
+        json positionsJson = json::array();
+        for (const auto& position : positionsLocked(id)) {
+            positionsJson.push_back({
+                {"symbol", position.symbol},
+                {"marginType", position.isolated ? "isolated" : "cross"},
+                {"positionAmt", position.positionAmt},
+                {"entryPrice", position.entryPrice},
+                {"markPrice", position.markPrice},
+                {"unRealizedProfit", position.unrealizedProfit},
+                {"maintMargin", position.maintMargin},
+                {"liquidationPrice", position.liquidationPrice}
+            });
+        }
+        accounts.push_back({
+            {"account", accounts_[id].name},
+            {"walletBalance", risk.walletBalance},
+            {"unrealizedProfit", risk.unrealizedProfit},
+            {"marginBalance", risk.marginBalance},
+            {"maintMargin", risk.maintMargin},
+            {"marginRatio", std::isfinite(risk.marginRatio) ? json(risk.marginRatio) : json()},
+            {"positions", positionsJson}
+        });
+    }
+    return accounts;
+}
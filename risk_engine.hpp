@@ -0,0 +1,187 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Keeps unrealised PnL, maintenance margin and liquidation prices current
+// from mark-price ticks alone, so REST is only needed to seed an account.
+// Positions of every account live in one columnar table grouped by account;
+// a tick costs O(positions in the ticked symbol), independent of how many
+// other symbols each account holds.
+class RiskEngine {
+public:
+    using AccountId = std::uint32_t;
+    using SymbolId = std::uint32_t;
+
+    struct Options {
+        // Used when the seed reports no maintenance margin for a position.
+        double defaultMaintenanceRate = 0.004;
+    };
+
+    enum class AlertKind {
+        MARGIN_RATIO,
+        LIQUIDATION_DISTANCE
+    };
+
+    struct Alert {
+        AlertKind kind;
+        AccountId account;
+        // The position's symbol for LIQUIDATION_DISTANCE, the ticked symbol
+        // for MARGIN_RATIO.
+        SymbolId symbol;
+        double value;
+        double threshold;
+        // From receipt of the tick to this callback.
+        std::int64_t latencyNs;
+    };
+
+    using AlertCallback = std::function<void(const Alert&)>;
+
+    struct AccountRisk {
+        double walletBalance = 0.0;
+        double unrealizedProfit = 0.0;
+        double marginBalance = 0.0;
+        double maintMargin = 0.0;
+        double marginRatio = 0.0;
+    };
+
+    struct PositionRisk {
+        std::string symbol;
+        bool isolated = false;
+        double positionAmt = 0.0;
+        double entryPrice = 0.0;
+        double markPrice = 0.0;
+        double unrealizedProfit = 0.0;
+        double maintMargin = 0.0;
+        double liquidationPrice = 0.0;
+    };
+
+    RiskEngine();
+    explicit RiskEngine(Options options);
+
+    AccountId addAccount(const std::string& name);
+    std::string accountName(AccountId account) const;
+
+    // Interns `symbol`; ids are dense and stable for the engine's lifetime.
+    SymbolId symbolId(const std::string& symbol);
+    std::string symbolName(SymbolId symbol) const;
+
+    // Replaces the account's balance and positions with getAccountInfo and
+    // getPositionRisk payloads. Marks already received by tick win over the
+    // payload's markPrice.
+    void seed(AccountId account, const nlohmann::json& accountInfo, const nlohmann::json& positionRisk);
+
+    template <typename Client>
+    void seedFrom(AccountId account, Client& client) {
+        seed(account, client.getAccountInfo(), client.getPositionRisk());
+    }
+
+    // Fires once when an account's maintenance margin reaches `ratio` of its
+    // cross margin balance, and again only after it has dropped back below.
+    void onMarginRatio(double ratio, AlertCallback callback);
+
+    // Fires once when a position's mark comes within `fraction` of its
+    // liquidation price, and again only after it has moved back out.
+    void onLiquidationDistance(double fraction, AlertCallback callback);
+
+    // Callbacks run on the calling thread after the engine's lock is
+    // released, so they may query the engine.
+    void onMarkPrice(SymbolId symbol, double markPrice);
+    // Ignores symbols no seed or symbolId() call has introduced.
+    void onMarkPrice(const std::string& symbol, double markPrice);
+
+    AccountRisk account(AccountId account) const;
+    std::vector<PositionRisk> positions(AccountId account) const;
+    std::size_t positionCount() const;
+
+    nlohmann::json toJson() const;
+
+private:
+    struct AccountState {
+        std::string name;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        double wallet = 0.0;
+        double crossUnrealized = 0.0;
+        double crossMaint = 0.0;
+        bool ratioAlerted = false;
+        // Bounds on the cross rows' alert triggers: no armed row can fire
+        // while headroom stays above armedMax, and no alerted row can re-arm
+        // while it stays at or below alertedMin. Ticks only ever widen them;
+        // a scan restores them exactly.
+        double armedMax = 0.0;
+        double alertedMin = 0.0;
+
+        // Margin balance net of maintenance margin. Every cross row's
+        // liquidation price is linear in this one value.
+        double headroom() const { return wallet + crossUnrealized - crossMaint; }
+        double marginRatio() const;
+    };
+
+    struct Row {
+        SymbolId symbol;
+        double qty;
+        double entry;
+        double mark;
+        double maintRate;
+        double cross;
+        double isolatedWallet;
+    };
+
+    SymbolId internLocked(const std::string& symbol);
+    void rebuildIndex();
+    void updateRows(std::size_t begin, std::size_t end);
+    void updateRow(std::size_t row);
+    void recompute(AccountState& account);
+    void scanLiquidation(AccountId id, std::vector<Alert>& alerts);
+    void evaluate(AccountId id, SymbolId ticked, std::vector<Alert>& alerts);
+    double liquidationPrice(std::size_t row) const;
+    AccountRisk accountLocked(AccountId id) const;
+    std::vector<PositionRisk> positionsLocked(AccountId id) const;
+
+    Options options_;
+    mutable std::mutex mutex_;
+
+    std::vector<AccountState> accounts_;
+    std::unordered_map<std::string, SymbolId> symbolIds_;
+    std::vector<std::string> symbolNames_;
+    std::vector<double> lastMark_;
+
+    // Position table, one column per field. `cross_` is 1 for cross-margin
+    // rows and 0 for isolated ones so the loops stay branch-free.
+    //
+    // A row's liquidation price is (cross * headroom + offset) * inverseSlope,
+    // and its distance alert is breached once cross * headroom <= trigger.
+    // Both offset and trigger depend only on the row's own mark, so a tick
+    // touches just the ticked symbol's rows plus one scalar per account.
+    std::vector<AccountId> owner_;
+    std::vector<SymbolId> symbol_;
+    std::vector<double> qty_;
+    std::vector<double> entry_;
+    std::vector<double> mark_;
+    std::vector<double> maintRate_;
+    std::vector<double> cross_;
+    std::vector<double> isolatedWallet_;
+    std::vector<double> unrealized_;
+    std::vector<double> maint_;
+    std::vector<double> inverseSlope_;
+    std::vector<double> offset_;
+    std::vector<double> trigger_;
+    std::vector<unsigned char> liquidationAlerted_;
+
+    // Per symbol: the rows holding it and the accounts those rows belong to.
+    std::vector<std::vector<std::uint32_t>> symbolRows_;
+    std::vector<std::vector<AccountId>> symbolAccounts_;
+
+    double marginRatioThreshold_ = 0.0;
+    AlertCallback marginRatioCallback_;
+    double liquidationThreshold_ = 0.0;
+    AlertCallback liquidationCallback_;
+};
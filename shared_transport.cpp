@@ -0,0 +1,42 @@
+#include "shared_transport.hpp"
+
+#include <curl/curl.h>
+
+#include <stdexcept>
+
+SharedTransport::SharedTransport() {
+    // Worker threads create easy handles concurrently; make sure libcurl's
+    // global state exists before any of them do.
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    CURLSH* share = curl_share_init();
+    if (!share) {
+        curl_global_cleanup();
+        throw std::runtime_error("Failed to initialise curl share handle");
+    }
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &SharedTransport::lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &SharedTransport::unlock);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    share_ = share;
+}
+
+SharedTransport::~SharedTransport() {
+    curl_share_cleanup(static_cast<CURLSH*>(share_));
+    curl_global_cleanup();
+}
+
+void SharedTransport::attach(void* curlHandle) const {
+    curl_easy_setopt(static_cast<CURL*>(curlHandle), CURLOPT_SHARE, static_cast<CURLSH*>(share_));
+}
+
+void SharedTransport::lock(void*, int data, int, void* userptr) {
+    auto* self = static_cast<SharedTransport*>(userptr);
+    self->locks_[static_cast<std::size_t>(data) % self->locks_.size()].lock();
+}
+
+void SharedTransport::unlock(void*, int data, void* userptr) {
+    auto* self = static_cast<SharedTransport*>(userptr);
+    self->locks_[static_cast<std::size_t>(data) % self->locks_.size()].unlock();
+}
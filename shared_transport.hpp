@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+
+// Shares libcurl's connection cache, DNS cache and TLS session cache between
+// every easy handle attached to it, so clients that create a fresh handle per
+// request still reuse warm connections.
+class SharedTransport {
+public:
+    SharedTransport();
+    ~SharedTransport();
+
+    SharedTransport(const SharedTransport&) = delete;
+    SharedTransport& operator=(const SharedTransport&) = delete;
+
+    void attach(void* curlHandle) const;
+
+private:
+    static void lock(void* handle, int data, int access, void* userptr);
+    static void unlock(void* handle, int data, void* userptr);
+
+    void* share_;
+    std::array<std::mutex, 8> locks_;
+};
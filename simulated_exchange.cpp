@@ -0,0 +1,902 @@
+#include "simulated_exchange.hpp"
+#include "kline_aggregator.hpp"
+#include "text_format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using json = nlohmann::json;
+
+namespace {
+constexpr double kEpsilon = 1e-12;
+constexpr std::int64_t kMaxOrderWindowMs = 7LL * 24 * 60 * 60 * 1000;
+
+bool is_exchange_interval(const std::string& interval) {
+    static const char* const kIntervals[] = {"1m", "3m", "5m", "15m", "30m", "1h", "2h", "4h",
+                                             "6h", "8h", "12h", "1d", "3d", "1w"};
+    return std::find(std::begin(kIntervals), std::end(kIntervals), interval) != std::end(kIntervals);
+}
+
+// Rejections raise the same HttpError performRequest raises for an HTTP 400,
+// so callers handle them identically in both backends.
+[[noreturn]] void reject(int code, const std::string& message) {
+    throw HttpError(400, json{{"code", code}, {"msg", message}}.dump());
+}
+
+const char* side_name(BinanceFuturesClient::Side side) {
+    return side == BinanceFuturesClient::Side::BUY ? "BUY" : "SELL";
+}
+
+const char* type_name(BinanceFuturesClient::OrderType type) {
+    switch (type) {
+        case BinanceFuturesClient::OrderType::MARKET:
+            return "MARKET";
+        case BinanceFuturesClient::OrderType::LIMIT:
+            return "LIMIT";
+        case BinanceFuturesClient::OrderType::STOP_MARKET:
+            return "STOP_MARKET";
+        case BinanceFuturesClient::OrderType::TAKE_PROFIT_MARKET:
+            return "TAKE_PROFIT_MARKET";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+const char* tif_name(BinanceFuturesClient::TimeInForce tif) {
+    switch (tif) {
+        case BinanceFuturesClient::TimeInForce::GTC:
+            return "GTC";
+        case BinanceFuturesClient::TimeInForce::IOC:
+            return "IOC";
+        case BinanceFuturesClient::TimeInForce::FOK:
+            return "FOK";
+        case BinanceFuturesClient::TimeInForce::GTX:
+            return "GTX";
+        default:
+            return "GTC";
+    }
+}
+
+// Within one candle the path between high and low is unknown. Stops are
+// matched first and take-profits last so that a candle touching both
+// resolves pessimistically.
+int match_priority(BinanceFuturesClient::OrderType type) {
+    switch (type) {
+        case BinanceFuturesClient::OrderType::STOP_MARKET:
+            return 0;
+        case BinanceFuturesClient::OrderType::LIMIT:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+// Anchored at a start cursor the exchange returns the oldest `limit`
+// matches, otherwise the newest.
+template <typename T>
+void keep_page(std::vector<T>& items, int limit, bool fromStart) {
+    const std::size_t count = static_cast<std::size_t>(std::max(limit, 0));
+    if (items.size() <= count) {
+        return;
+    }
+    if (fromStart) {
+        items.resize(count);
+    } else {
+        items.erase(items.begin(), items.end() - static_cast<std::ptrdiff_t>(count));
+    }
+}
+
+bool is_final(const char* status) {
+    const std::string value = status;
+    return value != "NEW" && value != "PARTIALLY_FILLED";
+}
+}  // namespace
+
+SimulatedExchange::SimulatedExchange(Options options)
+    : options_(options),
+      walletBalance_(options.initialBalance),
+      peakEquity_(options.initialBalance) {
+}
+
+void SimulatedExchange::addSymbol(const std::string& symbol,
+                                  std::shared_ptr<const KlineSeries> klines,
+                                  std::vector<FundingEvent> funding) {
+    if (!klines) {
+        throw std::runtime_error("Klines are required for simulated symbol " + symbol);
+    }
+    const std::string name = uppercase(symbol);
+    if (index_.count(name)) {
+        throw std::runtime_error("Symbol already added: " + name);
+    }
+
+    SymbolState s;
+    s.symbol = name;
+    s.klines = std::move(klines);
+    s.leverage = options_.defaultLeverage;
+    std::sort(funding.begin(), funding.end(), [](const FundingEvent& a, const FundingEvent& b) { return a.time < b.time; });
+    s.funding = std::move(funding);
+    if (!s.klines->empty() && options_.fundingIntervalMs > 0) {
+        const std::int64_t first = s.klines->openTime.front();
+        s.nextFundingTime = (first / options_.fundingIntervalMs + 1) * options_.fundingIntervalMs;
+    }
+
+    index_.emplace(name, symbols_.size());
+    symbols_.push_back(std::move(s));
+}
+
+SimulatedExchange::SymbolState& SimulatedExchange::state(const std::string& symbol) {
+    auto it = index_.find(uppercase(symbol));
+    if (it == index_.end()) {
+        reject(-1121, "Invalid symbol.");
+    }
+    return symbols_[it->second];
+}
+
+const SimulatedExchange::SymbolState& SimulatedExchange::state(const std::string& symbol) const {
+    auto it = index_.find(uppercase(symbol));
+    if (it == index_.end()) {
+        reject(-1121, "Invalid symbol.");
+    }
+    return symbols_[it->second];
+}
+
+const KlineSeries& SimulatedExchange::klines(const std::string& symbol) const {
+    return *state(symbol).klines;
+}
+
+std::size_t SimulatedExchange::barIndex(const std::string& symbol) const {
+    const SymbolState& s = state(symbol);
+    if (s.next == 0) {
+        throw std::runtime_error("No candle has closed yet for " + s.symbol);
+    }
+    return s.next - 1;
+}
+
+bool SimulatedExchange::step() {
+    std::int64_t openTime = std::numeric_limits<std::int64_t>::max();
+    for (const auto& s : symbols_) {
+        if (s.next < s.klines->size()) {
+            openTime = std::min(openTime, s.klines->openTime[s.next]);
+        }
+    }
+    if (openTime == std::numeric_limits<std::int64_t>::max()) {
+        return false;
+    }
+
+    for (auto& s : symbols_) {
+        if (s.next >= s.klines->size() || s.klines->openTime[s.next] != openTime) {
+            continue;
+        }
+        const std::size_t index = s.next++;
+        now_ = std::max(now_, s.klines->closeTime(index));
+        if (index > 0) {
+            matchBar(s, index);
+        }
+        s.mark = s.klines->close[index];
+        settleFunding(s, s.klines->closeTime(index) + 1);
+    }
+
+    checkLiquidation();
+
+    const double current = equity();
+    peakEquity_ = std::max(peakEquity_, current);
+    if (peakEquity_ > 0.0) {
+        maxDrawdown_ = std::max(maxDrawdown_, (peakEquity_ - current) / peakEquity_);
+    }
+    return true;
+}
+
+void SimulatedExchange::matchBar(SymbolState& s, std::size_t index) {
+    const KlineSeries& k = *s.klines;
+    const double open = k.open[index];
+    const double high = k.high[index];
+    const double low = k.low[index];
+
+    // Liquidation is checked at the candle's adverse extreme rather than its
+    // close. A stop the price only reaches beyond the liquidation price is
+    // left for the liquidation instead of filling first.
+    const double position = s.positionQty;
+    const double liquidation = liquidationPrice(s);
+    auto beyondLiquidation = [&](const Order& order) {
+        if (std::fabs(position) < kEpsilon || (order.side == Side::SELL) != (position > 0)) {
+            return false;
+        }
+        return position > 0 ? order.stopPrice < liquidation : order.stopPrice > liquidation;
+    };
+
+    for (int priority = 0; priority < 3; ++priority) {
+        for (auto& order : s.openOrders) {
+            if (is_final(order.status) || match_priority(order.type) != priority) {
+                continue;
+            }
+            const bool buy = order.side == Side::BUY;
+            switch (order.type) {
+                case OrderType::LIMIT:
+                    if (buy ? low <= order.price : high >= order.price) {
+                        fill(s, order, order.price, true);
+                    }
+                    break;
+                case OrderType::STOP_MARKET:
+                    if ((buy ? high >= order.stopPrice : low <= order.stopPrice) && !beyondLiquidation(order)) {
+                        const double trigger = buy ? std::max(order.stopPrice, open) : std::min(order.stopPrice, open);
+                        fill(s, order, slipped(trigger, order.side), false);
+                    }
+                    break;
+                case OrderType::TAKE_PROFIT_MARKET:
+                    if (buy ? low <= order.stopPrice : high >= order.stopPrice) {
+                        const double trigger = buy ? std::min(order.stopPrice, open) : std::max(order.stopPrice, open);
+                        fill(s, order, slipped(trigger, order.side), false);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (priority == 0 && liquidateOnExtreme(s, open, high, low)) {
+            return;
+        }
+    }
+
+    s.openOrders.erase(std::remove_if(s.openOrders.begin(), s.openOrders.end(),
+                                      [](const Order& order) { return is_final(order.status); }),
+                       s.openOrders.end());
+}
+
+void SimulatedExchange::settleFunding(SymbolState& s, std::int64_t until) {
+    auto settle = [&](std::int64_t time, double rate) {
+        s.settled.push_back({time, rate, s.mark});
+        if (std::fabs(s.positionQty) < kEpsilon || rate == 0.0) {
+            return;
+        }
+        const double payment = -s.positionQty * s.mark * rate;
+        walletBalance_ += payment;
+        fundingPaid_ += payment;
+        addIncome(s, "FUNDING_FEE", payment);
+    };
+
+    if (!s.funding.empty()) {
+        while (s.fundingCursor < s.funding.size() && s.funding[s.fundingCursor].time <= until) {
+            settle(s.funding[s.fundingCursor].time, s.funding[s.fundingCursor].rate);
+            ++s.fundingCursor;
+        }
+        return;
+    }
+
+    if (options_.fundingIntervalMs <= 0) {
+        return;
+    }
+    while (s.nextFundingTime <= until) {
+        settle(s.nextFundingTime, options_.defaultFundingRate);
+        s.nextFundingTime += options_.fundingIntervalMs;
+    }
+}
+
+void SimulatedExchange::checkLiquidation() {
+    bool exposed = false;
+    for (const auto& s : symbols_) {
+        exposed = exposed || std::fabs(s.positionQty) > kEpsilon;
+    }
+    if (exposed && equity() <= maintenanceMargin()) {
+        liquidate();
+    }
+}
+
+bool SimulatedExchange::liquidateOnExtreme(SymbolState& s, double open, double high, double low) {
+    if (std::fabs(s.positionQty) < kEpsilon) {
+        return false;
+    }
+    const bool longPosition = s.positionQty > 0;
+    const double price = liquidationPrice(s);
+    if (longPosition ? low > price : high < price) {
+        return false;
+    }
+    // A candle that gaps through the liquidation price closes at its open.
+    s.mark = longPosition ? std::min(price, open) : std::max(price, open);
+    liquidate();
+    return true;
+}
+
+void SimulatedExchange::liquidate() {
+    ++liquidations_;
+    for (auto& s : symbols_) {
+        for (auto& order : s.openOrders) {
+            if (!is_final(order.status)) {
+                finish(s, order, "CANCELED");
+            }
+        }
+        s.openOrders.clear();
+        if (std::fabs(s.positionQty) > kEpsilon) {
+            const double pnl = unrealized(s);
+            walletBalance_ += pnl;
+            realizedPnl_ += pnl;
+            addIncome(s, "REALIZED_PNL", pnl);
+            s.positionQty = 0.0;
+            s.entryPrice = 0.0;
+        }
+    }
+    walletBalance_ = std::max(walletBalance_, 0.0);
+}
+
+bool SimulatedExchange::fill(SymbolState& s, Order& order, double price, bool maker) {
+    double quantity = order.origQty - order.executedQty;
+    const bool buy = order.side == Side::BUY;
+    if (order.reduceOnly) {
+        const double reducible = buy ? std::max(-s.positionQty, 0.0) : std::max(s.positionQty, 0.0);
+        quantity = std::min(quantity, reducible);
+        if (quantity < kEpsilon) {
+            finish(s, order, "EXPIRED");
+            return false;
+        }
+    }
+
+    const double signedQty = buy ? quantity : -quantity;
+    const double position = s.positionQty;
+    if (std::fabs(position) < kEpsilon || (position > 0) == (signedQty > 0)) {
+        const double size = std::fabs(position);
+        s.entryPrice = (size * s.entryPrice + quantity * price) / (size + quantity);
+        s.positionQty = position + signedQty;
+    } else {
+        const double closing = std::min(std::fabs(position), quantity);
+        const double pnl = closing * (price - s.entryPrice) * (position > 0 ? 1.0 : -1.0);
+        walletBalance_ += pnl;
+        realizedPnl_ += pnl;
+        addIncome(s, "REALIZED_PNL", pnl);
+        s.positionQty = position + signedQty;
+        if (std::fabs(s.positionQty) < kEpsilon) {
+            s.positionQty = 0.0;
+            s.entryPrice = 0.0;
+        } else if ((s.positionQty > 0) != (position > 0)) {
+            s.entryPrice = price;
+        }
+    }
+
+    const double fee = quantity * price * (maker ? options_.makerFee : options_.takerFee);
+    walletBalance_ -= fee;
+    fees_ += fee;
+    addIncome(s, "COMMISSION", -fee);
+
+    order.avgPrice = (order.avgPrice * order.executedQty + price * quantity) / (order.executedQty + quantity);
+    order.executedQty += quantity;
+    ++fills_;
+
+    // A reduce-only order clipped to the position never fills its remainder.
+    finish(s, order, order.executedQty >= order.origQty - kEpsilon ? "FILLED" : "EXPIRED");
+    return true;
+}
+
+void SimulatedExchange::finish(SymbolState& s, Order& order, const char* status) {
+    order.status = status;
+    order.updateTime = now_;
+    s.history.push_back(order);
+}
+
+void SimulatedExchange::addIncome(SymbolState& s, const char* type, double amount) {
+    s.income.push_back({now_, type, amount, nextTranId_++});
+}
+
+double SimulatedExchange::slipped(double price, Side side) const {
+    const double adjustment = price * options_.slippageBps / 10000.0;
+    return side == Side::BUY ? price + adjustment : price - adjustment;
+}
+
+double SimulatedExchange::unrealized(const SymbolState& s) const {
+    return s.positionQty * (s.mark - s.entryPrice);
+}
+
+double SimulatedExchange::equity() const {
+    double total = walletBalance_;
+    for (const auto& s : symbols_) {
+        total += unrealized(s);
+    }
+    return total;
+}
+
+double SimulatedExchange::initialMargin() const {
+    double total = 0.0;
+    for (const auto& s : symbols_) {
+        total += std::fabs(s.positionQty) * s.mark / std::max(s.leverage, 1);
+    }
+    return total;
+}
+
+double SimulatedExchange::openOrderMargin() const {
+    double total = 0.0;
+    for (const auto& s : symbols_) {
+        // Resting orders on the side opposite the position first use up the
+        // quantity that would close it.
+        double closable[2] = {std::max(-s.positionQty, 0.0), std::max(s.positionQty, 0.0)};
+        for (const auto& order : s.openOrders) {
+            if (order.reduceOnly || is_final(order.status)) {
+                continue;
+            }
+            double& left = closable[order.side == Side::BUY ? 0 : 1];
+            const double remaining = order.origQty - order.executedQty;
+            const double closing = std::min(remaining, left);
+            left -= closing;
+            const double reference = order.type == OrderType::LIMIT ? order.price : order.stopPrice;
+            total += (remaining - closing) * reference / std::max(s.leverage, 1);
+        }
+    }
+    return total;
+}
+
+double SimulatedExchange::maintenanceMargin() const {
+    double total = 0.0;
+    for (const auto& s : symbols_) {
+        total += std::fabs(s.positionQty) * s.mark * options_.maintenanceMarginRate;
+    }
+    return total;
+}
+
+double SimulatedExchange::liquidationPrice(const SymbolState& s) const {
+    const double size = std::fabs(s.positionQty);
+    if (size < kEpsilon) {
+        return 0.0;
+    }
+    // Cross margin: the equity left after the other positions' maintenance
+    // margin backs it, the same threshold checkLiquidation applies.
+    const double mmr = options_.maintenanceMarginRate;
+    const double backing = equity() - unrealized(s) - (maintenanceMargin() - size * s.mark * mmr);
+    const double price = s.positionQty > 0 ? (size * s.entryPrice - backing) / (size * (1.0 - mmr))
+                                           : (backing + size * s.entryPrice) / (size * (1.0 + mmr));
+    return std::max(price, 0.0);
+}
+
+SimulatedExchange::Order SimulatedExchange::makeOrder(const SymbolState& s,
+                                                      const OrderRequest& request,
+                                                      OrderType type,
+                                                      Side side) const {
+    Order order;
+    order.orderId = nextOrderId_;
+    order.side = side;
+    order.type = type;
+    order.timeInForce = request.timeInForce.value_or(TimeInForce::GTC);
+    order.price = request.price.value_or(0.0);
+    order.stopPrice = request.stopPrice.value_or(0.0);
+    order.reduceOnly = request.reduceOnly.value_or(false);
+    order.clientOrderId = request.clientOrderId.value_or("sim_" + std::to_string(order.orderId));
+    order.time = now_;
+    order.updateTime = now_;
+    if (request.quantity) {
+        order.origQty = *request.quantity;
+    } else if (request.quoteOrderQty) {
+        const double reference = order.price > 0.0 ? order.price : s.mark;
+        order.origQty = *request.quoteOrderQty / reference;
+    }
+    return order;
+}
+
+json SimulatedExchange::submit(SymbolState& s, Order order) {
+    if (s.next == 0) {
+        reject(-1121, "No market data yet for " + s.symbol + ".");
+    }
+    if (order.origQty <= 0.0) {
+        reject(-4003, "Quantity less than or equal to zero.");
+    }
+    const bool buy = order.side == Side::BUY;
+
+    switch (order.type) {
+        case OrderType::LIMIT:
+            if (order.price <= 0.0) {
+                reject(-1102, "Mandatory parameter 'price' was not sent, was empty/null, or malformed.");
+            }
+            break;
+        case OrderType::STOP_MARKET:
+        case OrderType::TAKE_PROFIT_MARKET: {
+            if (order.stopPrice <= 0.0) {
+                reject(-1102, "Mandatory parameter 'stopPrice' was not sent, was empty/null, or malformed.");
+            }
+            const bool stop = order.type == OrderType::STOP_MARKET;
+            const bool triggered = stop == buy ? s.mark >= order.stopPrice : s.mark <= order.stopPrice;
+            if (triggered) {
+                reject(-2021, "Order would immediately trigger.");
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (!order.reduceOnly) {
+        const double opposing = buy ? std::max(-s.positionQty, 0.0) : std::max(s.positionQty, 0.0);
+        const double opening = std::max(order.origQty - opposing, 0.0);
+        const double reference = order.type == OrderType::MARKET ? s.mark
+                                 : order.type == OrderType::LIMIT ? order.price
+                                                                  : order.stopPrice;
+        const double required = opening * reference / std::max(s.leverage, 1);
+        if (required > equity() - initialMargin() - openOrderMargin() + kEpsilon) {
+            reject(-2019, "Margin is insufficient.");
+        }
+    }
+
+    ++nextOrderId_;
+
+    if (order.type == OrderType::MARKET) {
+        fill(s, order, slipped(s.mark, order.side), false);
+        return orderJson(s.symbol, order);
+    }
+
+    if (order.type == OrderType::LIMIT) {
+        const bool marketable = buy ? order.price >= s.mark : order.price <= s.mark;
+        if (marketable && order.timeInForce == TimeInForce::GTX) {
+            finish(s, order, "EXPIRED");
+            return orderJson(s.symbol, order);
+        }
+        if (marketable) {
+            fill(s, order, s.mark, false);
+            return orderJson(s.symbol, order);
+        }
+        if (order.timeInForce == TimeInForce::IOC || order.timeInForce == TimeInForce::FOK) {
+            finish(s, order, "EXPIRED");
+            return orderJson(s.symbol, order);
+        }
+    }
+
+    s.openOrders.push_back(order);
+    return orderJson(s.symbol, order);
+}
+
+json SimulatedExchange::orderJson(const std::string& symbol, const Order& order) {
+    return json{
+        {"orderId", order.orderId},
+        {"symbol", symbol},
+        {"status", order.status},
+        {"clientOrderId", order.clientOrderId},
+        {"price", format_decimal(order.price)},
+        {"avgPrice", format_decimal(order.avgPrice)},
+        {"origQty", format_decimal(order.origQty)},
+        {"executedQty", format_decimal(order.executedQty)},
+        {"cumQuote", format_decimal(order.executedQty * order.avgPrice)},
+        {"timeInForce", tif_name(order.timeInForce)},
+        {"type", type_name(order.type)},
+        {"origType", type_name(order.type)},
+        {"reduceOnly", order.reduceOnly},
+        {"side", side_name(order.side)},
+        {"positionSide", "BOTH"},
+        {"stopPrice", format_decimal(order.stopPrice)},
+        {"workingType", "MARK_PRICE"},
+        {"time", order.time},
+        {"updateTime", order.updateTime}
+    };
+}
+
+json SimulatedExchange::getContinuousKlines(const std::string& pair,
+                                            const std::string& interval,
+                                            int limit,
+                                            const std::string& contractType) {
+    if (uppercase(contractType) != "PERPETUAL") {
+        reject(-1100, "Illegal characters found in parameter 'contractType'.");
+    }
+    const SymbolState& s = state(pair);
+    const std::size_t end = s.next;
+    const std::size_t count = static_cast<std::size_t>(std::max(limit, 0));
+    if (interval == s.klines->interval) {
+        return s.klines->toJson(end > count ? end - count : 0, end);
+    }
+
+    // Coarser intervals are derived from the stored candles closed so far,
+    // so the newest one is partial just like the exchange's.
+    if (!is_exchange_interval(interval)) {
+        reject(-1120, "Invalid interval.");
+    }
+    std::int64_t intervalMs = 0;
+    std::size_t begin = end;
+    try {
+        intervalMs = KlineSeries::intervalToMs(interval);
+        if (end > 0 && count > 0) {
+            const auto& openTime = s.klines->openTime;
+            const std::int64_t from = KlineAggregator::bucketStart(openTime[end - 1], intervalMs) -
+                                      static_cast<std::int64_t>(count - 1) * intervalMs;
+            begin = static_cast<std::size_t>(
+                std::lower_bound(openTime.begin(), openTime.begin() + static_cast<std::ptrdiff_t>(end), from) - openTime.begin());
+        }
+        const KlineSeries derived = KlineAggregator::aggregate(*s.klines, interval, begin, end);
+        return derived.toJson(0, derived.size());
+    } catch (const std::runtime_error&) {
+        reject(-1120, "Invalid interval.");
+    }
+}
+
+json SimulatedExchange::setLeverage(const std::string& symbol, int leverage) {
+    if (leverage < 1 || leverage > 125) {
+        reject(-4028, "Leverage " + std::to_string(leverage) + " is not valid");
+    }
+    SymbolState& s = state(symbol);
+    s.leverage = leverage;
+    return json{{"leverage", leverage}, {"maxNotionalValue", "INF"}, {"symbol", s.symbol}};
+}
+
+json SimulatedExchange::placeOrder(const OrderRequest& request) {
+    if (!request.quantity && !request.quoteOrderQty) {
+        throw std::runtime_error("Either quantity or quoteOrderQty must be provided");
+    }
+    SymbolState& s = state(request.symbol);
+
+    json result;
+    json entry = submit(s, makeOrder(s, request, request.type, request.side));
+    result["entry"] = entry;
+
+    // Mirrors the protective orders placeOrder sends after the entry.
+    const double executedQty = std::stod(entry.at("executedQty").get<std::string>());
+    auto createOcoOrder = [&](const std::optional<double>& priceValue, OrderType orderType) -> std::optional<json> {
+        if (!priceValue) {
+            return std::nullopt;
+        }
+        OrderRequest protective;
+        protective.symbol = request.symbol;
+        protective.side = request.side == Side::BUY ? Side::SELL : Side::BUY;
+        protective.type = orderType;
+        protective.stopPrice = *priceValue;
+        protective.reduceOnly = true;
+        if (executedQty > 0.0) {
+            protective.quantity = executedQty;
+        } else if (request.quantity) {
+            protective.quantity = *request.quantity;
+        } else {
+            throw std::runtime_error("Unable to determine quantity for protective order");
+        }
+        return submit(s, makeOrder(s, protective, orderType, protective.side));
+    };
+
+    if (auto stopLoss = createOcoOrder(request.stopLossPrice, OrderType::STOP_MARKET)) {
+        result["stopLoss"] = *stopLoss;
+    }
+    if (auto takeProfit = createOcoOrder(request.takeProfitPrice, OrderType::TAKE_PROFIT_MARKET)) {
+        result["takeProfit"] = *takeProfit;
+    }
+    return result;
+}
+
+json SimulatedExchange::getOpenOrders(const std::string& symbol) {
+    json result = json::array();
+    for (const auto& s : symbols_) {
+        if (!symbol.empty() && s.symbol != uppercase(symbol)) {
+            continue;
+        }
+        for (const auto& order : s.openOrders) {
+            result.push_back(orderJson(s.symbol, order));
+        }
+    }
+    return result;
+}
+
+std::vector<const SimulatedExchange::Order*> SimulatedExchange::ordersById(const SymbolState& s) {
+    std::vector<const Order*> orders;
+    orders.reserve(s.history.size() + s.openOrders.size());
+    for (const auto& order : s.history) {
+        orders.push_back(&order);
+    }
+    for (const auto& order : s.openOrders) {
+        orders.push_back(&order);
+    }
+    std::sort(orders.begin(), orders.end(), [](const Order* a, const Order* b) { return a->orderId < b->orderId; });
+    return orders;
+}
+
+json SimulatedExchange::getAllOrders(const std::string& symbol, int limit) {
+    return getAllOrders(symbol, HistoryRange{}, limit);
+}
+
+json SimulatedExchange::getAllOrders(const std::string& symbol, const HistoryRange& range, int limit) {
+    if (range.startTime && range.endTime && *range.endTime - *range.startTime >= kMaxOrderWindowMs) {
+        reject(-1127, "More than 7 days between startTime and endTime.");
+    }
+    const SymbolState& s = state(symbol);
+    std::vector<const Order*> orders = ordersById(s);
+    orders.erase(std::remove_if(orders.begin(), orders.end(),
+                                [&](const Order* order) {
+                                    return (range.fromId && order->orderId < *range.fromId) ||
+                                           (range.startTime && order->time < *range.startTime) ||
+                                           (range.endTime && order->time > *range.endTime);
+                                }),
+                 orders.end());
+    keep_page(orders, limit, range.fromId || range.startTime);
+
+    json result = json::array();
+    for (const Order* order : orders) {
+        result.push_back(orderJson(s.symbol, *order));
+    }
+    return result;
+}
+
+json SimulatedExchange::getAccountInfo() {
+    const double unrealizedTotal = equity() - walletBalance_;
+    const double margin = initialMargin();
+    const double orderMargin = openOrderMargin();
+    const double available = std::max(walletBalance_ + unrealizedTotal - margin - orderMargin, 0.0);
+    json positions = json::array();
+    for (const auto& s : symbols_) {
+        positions.push_back({
+            {"symbol", s.symbol},
+            {"initialMargin", format_decimal(std::fabs(s.positionQty) * s.mark / std::max(s.leverage, 1))},
+            {"maintMargin", format_decimal(std::fabs(s.positionQty) * s.mark * options_.maintenanceMarginRate)},
+            {"unrealizedProfit", format_decimal(unrealized(s))},
+            {"leverage", std::to_string(s.leverage)},
+            {"entryPrice", format_decimal(s.entryPrice)},
+            {"positionSide", "BOTH"},
+            {"positionAmt", format_decimal(s.positionQty)},
+            {"updateTime", now_}
+        });
+    }
+    return json{
+        {"totalWalletBalance", format_decimal(walletBalance_)},
+        {"totalUnrealizedProfit", format_decimal(unrealizedTotal)},
+        {"totalMarginBalance", format_decimal(walletBalance_ + unrealizedTotal)},
+        {"totalInitialMargin", format_decimal(margin)},
+        {"totalOpenOrderInitialMargin", format_decimal(orderMargin)},
+        {"totalMaintMargin", format_decimal(maintenanceMargin())},
+        {"availableBalance", format_decimal(available)},
+        {"maxWithdrawAmount", format_decimal(available)},
+        {"assets", json::array({{{"asset", "USDT"}, {"walletBalance", format_decimal(walletBalance_)}}})},
+        {"positions", positions},
+        {"updateTime", now_}
+    };
+}
+
+json SimulatedExchange::getPositionRisk(const std::string& symbol) {
+    json result = json::array();
+    for (const auto& s : symbols_) {
+        if (!symbol.empty() && s.symbol != uppercase(symbol)) {
+            continue;
+        }
+        result.push_back({
+            {"symbol", s.symbol},
+            {"positionAmt", format_decimal(s.positionQty)},
+            {"entryPrice", format_decimal(s.entryPrice)},
+            {"markPrice", format_decimal(s.mark)},
+            {"unRealizedProfit", format_decimal(unrealized(s))},
+            {"liquidationPrice", format_decimal(liquidationPrice(s))},
+            {"leverage", std::to_string(s.leverage)},
+            {"marginType", "cross"},
+            {"positionSide", "BOTH"},
+            {"notional", format_decimal(s.positionQty * s.mark)},
+            {"updateTime", now_}
+        });
+    }
+    return result;
+}
+
+json SimulatedExchange::getFundingRate(const std::string& symbol, int limit) {
+    const SymbolState& s = state(symbol);
+    json result = json::array();
+    const std::size_t count = static_cast<std::size_t>(std::max(limit, 0));
+    for (std::size_t i = s.settled.size() > count ? s.settled.size() - count : 0; i < s.settled.size(); ++i) {
+        result.push_back({
+            {"symbol", s.symbol},
+            {"fundingTime", s.settled[i].time},
+            {"fundingRate", format_decimal(s.settled[i].rate)},
+            {"markPrice", format_decimal(s.settled[i].markPrice)}
+        });
+    }
+    return result;
+}
+
+json SimulatedExchange::getFundingFeeHistory(const std::string& symbol, int limit) {
+    return getIncomeHistory(symbol, "FUNDING_FEE", HistoryRange{}, limit);
+}
+
+json SimulatedExchange::getIncomeHistory(const std::string& symbol,
+                                         const std::string& incomeType,
+                                         const HistoryRange& range,
+                                         int limit) {
+    if (!symbol.empty()) {
+        state(symbol);
+    }
+    const std::string name = uppercase(symbol);
+    const std::string type = uppercase(incomeType);
+
+    std::vector<std::pair<const SymbolState*, const Income*>> entries;
+    for (const auto& s : symbols_) {
+        if (!name.empty() && s.symbol != name) {
+            continue;
+        }
+        for (const auto& income : s.income) {
+            if ((!type.empty() && type != income.type) ||
+                (range.startTime && income.time < *range.startTime) ||
+                (range.endTime && income.time > *range.endTime)) {
+                continue;
+            }
+            entries.emplace_back(&s, &income);
+        }
+    }
+    // tranIds are issued in time order across all symbols.
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& a, const auto& b) { return a.second->tranId < b.second->tranId; });
+    keep_page(entries, limit, range.startTime.has_value());
+
+    json result = json::array();
+    for (const auto& [s, income] : entries) {
+        result.push_back(incomeJson(s->symbol, *income));
+    }
+    return result;
+}
+
+json SimulatedExchange::incomeJson(const std::string& symbol, const Income& income) {
+    return json{
+        {"symbol", symbol},
+        {"incomeType", income.type},
+        {"income", format_decimal(income.amount)},
+        {"asset", "USDT"},
+        {"info", ""},
+        {"time", income.time},
+        {"tranId", income.tranId},
+        {"tradeId", ""}
+    };
+}
+
+json SimulatedExchange::closePosition(const std::string& symbol) {
+    SymbolState& s = state(symbol);
+    if (std::fabs(s.positionQty) < kEpsilon) {
+        return json{{"symbol", s.symbol}, {"message", "No open position"}};
+    }
+    OrderRequest request;
+    request.symbol = s.symbol;
+    request.side = s.positionQty > 0 ? Side::SELL : Side::BUY;
+    request.type = OrderType::MARKET;
+    request.quantity = std::fabs(s.positionQty);
+    request.reduceOnly = true;
+    json response = submit(s, makeOrder(s, request, request.type, request.side));
+    return json{{"symbol", s.symbol}, {"close", response}};
+}
+
+json SimulatedExchange::getExchangeInfo() {
+    json symbols = json::array();
+    for (const auto& s : symbols_) {
+        json filters = json::array();
+        filters.push_back({{"filterType", "PRICE_FILTER"}, {"tickSize", options_.tickSize}, {"minPrice", options_.tickSize}, {"maxPrice", "0"}});
+        filters.push_back({{"filterType", "LOT_SIZE"}, {"stepSize", options_.stepSize}, {"minQty", options_.stepSize}, {"maxQty", "0"}});
+        filters.push_back({{"filterType", "MIN_NOTIONAL"}, {"notional", format_decimal(options_.minNotional)}});
+        symbols.push_back({
+            {"symbol", s.symbol},
+            {"pair", s.symbol},
+            {"contractType", "PERPETUAL"},
+            {"status", "TRADING"},
+            {"marginAsset", "USDT"},
+            {"filters", filters}
+        });
+    }
+    return json{{"timezone", "UTC"}, {"serverTime", now_}, {"symbols", symbols}};
+}
+
+json SimulatedExchange::getLeverageBrackets(const std::string& symbol) {
+    if (!symbol.empty()) {
+        state(symbol);
+    }
+    json result = json::array();
+    for (const auto& s : symbols_) {
+        if (!symbol.empty() && s.symbol != uppercase(symbol)) {
+            continue;
+        }
+        json bracket = {
+            {"bracket", 1},
+            {"initialLeverage", 125},
+            {"notionalCap", std::numeric_limits<double>::max()},
+            {"notionalFloor", 0},
+            {"maintMarginRatio", options_.maintenanceMarginRate},
+            {"cum", 0}
+        };
+        result.push_back({{"symbol", s.symbol}, {"brackets", json::array({bracket})}});
+    }
+    return result;
+}
+
+json SimulatedExchange::summary() const {
+    const double finalEquity = equity();
+    return json{
+        {"initialBalance", options_.initialBalance},
+        {"finalEquity", finalEquity},
+        {"returnPct", options_.initialBalance > 0.0 ? (finalEquity / options_.initialBalance - 1.0) * 100.0 : 0.0},
+        {"realizedPnl", realizedPnl_},
+        {"fees", fees_},
+        {"funding", fundingPaid_},
+        {"fills", fills_},
+        {"liquidations", liquidations_},
+        {"maxDrawdownPct", maxDrawdown_ * 100.0},
+        {"endTime", now_}
+    };
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "binance_client.hpp"
+#include "kline_series.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Local stand-in for the futures exchange. It exposes the same request
+// methods as BinanceFuturesClient with the same argument types and response
+// shapes, so strategy code templated on the client type runs unchanged
+// against either. Time advances one candle per step() over locally stored
+// klines; orders match against each candle's range.
+class SimulatedExchange {
+public:
+    using Side = BinanceFuturesClient::Side;
+    using OrderType = BinanceFuturesClient::OrderType;
+    using TimeInForce = BinanceFuturesClient::TimeInForce;
+    using OrderRequest = BinanceFuturesClient::OrderRequest;
+    using HistoryRange = BinanceFuturesClient::HistoryRange;
+
+    struct Options {
+        double initialBalance = 10000.0;
+        double takerFee = 0.0004;
+        double makerFee = 0.0002;
+        double slippageBps = 0.0;
+        double maintenanceMarginRate = 0.004;
+        int defaultLeverage = 20;
+        // Applied at every funding time that has no explicit event.
+        double defaultFundingRate = 0.0;
+        std::int64_t fundingIntervalMs = 8LL * 60 * 60 * 1000;
+        // Trading rules getExchangeInfo reports for every symbol.
+        std::string tickSize = "0.01";
+        std::string stepSize = "0.001";
+        double minNotional = 5.0;
+    };
+
+    struct FundingEvent {
+        std::int64_t time;
+        double rate;
+    };
+
+    explicit SimulatedExchange(Options options);
+
+    void addSymbol(const std::string& symbol,
+                   std::shared_ptr<const KlineSeries> klines,
+                   std::vector<FundingEvent> funding = {});
+
+    // Closes the next candle on the merged timeline of all symbols, matching
+    // resting orders and settling funding. Returns false once data runs out.
+    bool step();
+
+    std::int64_t now() const { return now_; }
+
+    const KlineSeries& klines(const std::string& symbol) const;
+
+    // Index of the most recently closed candle for `symbol`.
+    std::size_t barIndex(const std::string& symbol) const;
+
+    nlohmann::json getContinuousKlines(const std::string& pair,
+                                       const std::string& interval,
+                                       int limit = 500,
+                                       const std::string& contractType = "PERPETUAL");
+
+    nlohmann::json setLeverage(const std::string& symbol, int leverage);
+
+    nlohmann::json placeOrder(const OrderRequest& request);
+
+    nlohmann::json getOpenOrders(const std::string& symbol = "");
+
+    nlohmann::json getAllOrders(const std::string& symbol, int limit = 500);
+
+    nlohmann::json getAllOrders(const std::string& symbol, const HistoryRange& range, int limit = 1000);
+
+    nlohmann::json getAccountInfo();
+
+    nlohmann::json getPositionRisk(const std::string& symbol = "");
+
+    nlohmann::json getFundingRate(const std::string& symbol, int limit = 1);
+
+    nlohmann::json getFundingFeeHistory(const std::string& symbol, int limit = 10);
+
+    nlohmann::json getIncomeHistory(const std::string& symbol,
+                                    const std::string& incomeType,
+                                    const HistoryRange& range,
+                                    int limit = 1000);
+
+    nlohmann::json closePosition(const std::string& symbol);
+
+    nlohmann::json getExchangeInfo();
+
+    // One uncapped bracket per symbol; the simulator has no notional tiers.
+    nlohmann::json getLeverageBrackets(const std::string& symbol = "");
+
+    double equity() const;
+
+    // Totals for the run so far: equity, PnL, fees, funding, fills and
+    // maximum drawdown.
+    nlohmann::json summary() const;
+
+private:
+    struct Order {
+        long long orderId = 0;
+        std::string clientOrderId;
+        Side side = Side::BUY;
+        OrderType type = OrderType::MARKET;
+        TimeInForce timeInForce = TimeInForce::GTC;
+        double price = 0.0;
+        double stopPrice = 0.0;
+        double origQty = 0.0;
+        double executedQty = 0.0;
+        double avgPrice = 0.0;
+        bool reduceOnly = false;
+        const char* status = "NEW";
+        std::int64_t time = 0;
+        std::int64_t updateTime = 0;
+    };
+
+    struct Income {
+        std::int64_t time;
+        const char* type;
+        double amount;
+        long long tranId;
+    };
+
+    struct FundingSettlement {
+        std::int64_t time;
+        double rate;
+        double markPrice;
+    };
+
+    struct SymbolState {
+        std::string symbol;
+        std::shared_ptr<const KlineSeries> klines;
+        std::size_t next = 0;
+        double mark = 0.0;
+        int leverage = 20;
+        double positionQty = 0.0;
+        double entryPrice = 0.0;
+        std::vector<Order> openOrders;
+        std::vector<Order> history;
+        std::vector<Income> income;
+        std::vector<FundingEvent> funding;
+        std::size_t fundingCursor = 0;
+        std::int64_t nextFundingTime = 0;
+        std::vector<FundingSettlement> settled;
+    };
+
+    SymbolState& state(const std::string& symbol);
+    const SymbolState& state(const std::string& symbol) const;
+
+    void matchBar(SymbolState& s, std::size_t index);
+    void settleFunding(SymbolState& s, std::int64_t until);
+    void checkLiquidation();
+    // Liquidates if the candle's adverse extreme for the position in `s`
+    // reaches its liquidation price.
+    bool liquidateOnExtreme(SymbolState& s, double open, double high, double low);
+    // Cancels every order and closes every position at its current mark.
+    void liquidate();
+
+    // Fills the remaining quantity at `price`; returns false if a reduce-only
+    // order had nothing to reduce and expired instead.
+    bool fill(SymbolState& s, Order& order, double price, bool maker);
+    void finish(SymbolState& s, Order& order, const char* status);
+    void addIncome(SymbolState& s, const char* type, double amount);
+
+    Order makeOrder(const SymbolState& s, const OrderRequest& request, OrderType type, Side side) const;
+    nlohmann::json submit(SymbolState& s, Order order);
+    double slipped(double price, Side side) const;
+    double unrealized(const SymbolState& s) const;
+    double initialMargin() const;
+    // Margin held for resting orders that would open or extend a position.
+    double openOrderMargin() const;
+    double maintenanceMargin() const;
+    double liquidationPrice(const SymbolState& s) const;
+
+    // Every order for the symbol, open or finished, by ascending orderId.
+    static std::vector<const Order*> ordersById(const SymbolState& s);
+
+    static nlohmann::json orderJson(const std::string& symbol, const Order& order);
+    static nlohmann::json incomeJson(const std::string& symbol, const Income& income);
+
+    Options options_;
+    std::vector<SymbolState> symbols_;
+    std::unordered_map<std::string, std::size_t> index_;
+    double walletBalance_;
+    double realizedPnl_ = 0.0;
+    double fees_ = 0.0;
+    double fundingPaid_ = 0.0;
+    std::size_t fills_ = 0;
+    std::size_t liquidations_ = 0;
+    double peakEquity_;
+    double maxDrawdown_ = 0.0;
+    std::int64_t now_ = 0;
+    long long nextOrderId_ = 1;
+    long long nextTranId_ = 1;
+};
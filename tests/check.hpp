@@ -0,0 +1,27 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal checks for the test executables: a failed CHECK is reported with
+// its location and makes check_exit_code() non-zero.
+
+inline int& check_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                      \
+    do {                                                                                      \
+        if (!(condition)) {                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++check_failures();                                                               \
+        }                                                                                     \
+    } while (false)
+
+inline int check_exit_code() {
+    if (check_failures() > 0) {
+        std::cerr << check_failures() << " check(s) failed\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "check.hpp"
+#include "endpoint_pinner.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Self-signed certificate for the stand-ins; the probe does not verify it.
+SSL_CTX* server_context() {
+    static SSL_CTX* context = [] {
+        SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+        EVP_PKEY* key = EVP_EC_gen("P-256");
+        X509* cert = X509_new();
+        if (!ctx || !key || !cert) {
+            throw std::runtime_error("Failed to create the stand-in certificate");
+        }
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("stand-in.test"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, key, EVP_sha256());
+        SSL_CTX_use_certificate(ctx, cert);
+        SSL_CTX_use_PrivateKey(ctx, key);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        return ctx;
+    }();
+    return context;
+}
+
+// TLS listener on one loopback address that holds every handshake for a
+// configurable delay, standing in for a distant exchange address.
+class StandIn {
+public:
+    StandIn(const std::string& address, int port)
+        : address_(address),
+          fd_(::socket(AF_INET, SOCK_STREAM, 0)) {
+        int one = 1;
+        setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(port));
+        inet_pton(AF_INET, address.c_str(), &addr.sin_addr);
+        socklen_t length = sizeof(addr);
+        if (fd_ < 0 || ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), length) != 0 || ::listen(fd_, 16) != 0 ||
+            getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+            throw std::runtime_error("Cannot listen on " + address + ":" + std::to_string(port));
+        }
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { serve(); });
+    }
+
+    ~StandIn() {
+        running_ = false;
+        thread_.join();
+        ::close(fd_);
+    }
+
+    StandIn(const StandIn&) = delete;
+    StandIn& operator=(const StandIn&) = delete;
+
+    const std::string& address() const { return address_; }
+    int port() const { return port_; }
+
+    void setDelay(std::chrono::milliseconds delay) { delayMs_ = delay.count(); }
+
+private:
+    void serve() {
+        while (running_) {
+            pollfd pfd{fd_, POLLIN, 0};
+            if (poll(&pfd, 1, 20) != 1) {
+                continue;
+            }
+            const int client = ::accept(fd_, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs_.load()));
+            SSL* ssl = SSL_new(server_context());
+            SSL_set_fd(ssl, client);
+            if (SSL_accept(ssl) == 1) {
+                SSL_shutdown(ssl);
+            }
+            SSL_free(ssl);
+            ::close(client);
+        }
+    }
+
+    std::string address_;
+    int fd_;
+    int port_ = 0;
+    std::atomic<long long> delayMs_{0};
+    std::atomic<bool> running_{true};
+    std::thread thread_;
+};
+
+bool contains(const std::vector<std::string>& values, const std::string& value) {
+    return std::find(values.begin(), values.end(), value) != values.end();
+}
+
+const EndpointPinner::Measurement* find_measurement(const std::vector<EndpointPinner::Measurement>& measurements,
+                                                     const std::string& address) {
+    for (const auto& measurement : measurements) {
+        if (measurement.address == address) {
+            return &measurement;
+        }
+    }
+    return nullptr;
+}
+}  // namespace
+
+int main() {
+    // The probe drops its connection straight after the handshake.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    auto slow = std::make_unique<StandIn>("127.0.0.2", 0);
+    StandIn fast("127.0.0.3", slow->port());
+    StandIn middle("127.0.0.4", slow->port());
+    slow->setDelay(120ms);
+    fast.setDelay(5ms);
+    middle.setDelay(50ms);
+
+    EndpointPinner::Options options;
+    options.host = "stand-in.test";
+    options.port = slow->port();
+    options.addresses = {slow->address(), fast.address(), middle.address()};
+    options.samples = 3;
+    options.pinCount = 2;
+    options.degradeFactor = 1.5;
+    EndpointPinner pinner(options);
+
+    // Ranking: the fastest healthy addresses are pinned, best first.
+    pinner.probeNow();
+    CHECK(pinner.pinned() == (std::vector<std::string>{fast.address(), middle.address()}));
+
+    // Hysteresis: a primary within degradeFactor of the best stays pinned...
+    fast.setDelay(60ms);
+    pinner.probeNow();
+    CHECK(!pinner.pinned().empty() && pinner.pinned().front() == fast.address());
+
+    // ...and is replaced once it falls further behind.
+    fast.setDelay(150ms);
+    pinner.probeNow();
+    CHECK(!pinner.pinned().empty() && pinner.pinned().front() == middle.address());
+
+    // Failover: a reported failure unpins the address at once, and the next
+    // probe that finds it healthy and fastest pins it again.
+    pinner.reportFailure(middle.address());
+    CHECK(!pinner.pinned().empty() && !contains(pinner.pinned(), middle.address()));
+    pinner.probeNow();
+    CHECK(!pinner.pinned().empty() && pinner.pinned().front() == middle.address());
+
+    // An address that refuses connections is unhealthy and never pinned.
+    const std::string down = slow->address();
+    slow.reset();
+    pinner.probeNow();
+    const auto measurements = pinner.measurements();
+    const auto* measurement = find_measurement(measurements, down);
+    CHECK(measurement && !measurement->healthy);
+    CHECK(!contains(pinner.pinned(), down));
+
+    return check_exit_code();
+}
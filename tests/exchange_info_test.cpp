@@ -0,0 +1,241 @@
+#include "check.hpp"
+#include "exchange_info.hpp"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using json = nlohmann::json;
+using Verdict = ExchangeInfoCache::Verdict;
+using OrderCheck = ExchangeInfoCache::OrderCheck;
+
+namespace {
+json symbol_entry(const std::string& symbol,
+                  const std::string& tickSize,
+                  const std::string& minPrice,
+                  const std::string& maxPrice,
+                  const std::string& stepSize,
+                  const std::string& minQty,
+                  const std::string& maxQty,
+                  const std::string& marketStepSize,
+                  const std::string& marketMaxQty,
+                  const std::string& notional) {
+    return json{
+        {"symbol", symbol},
+        {"status", "TRADING"},
+        {"pricePrecision", 8},
+        {"quantityPrecision", 8},
+        {"filters",
+         json::array({
+             {{"filterType", "PRICE_FILTER"}, {"tickSize", tickSize}, {"minPrice", minPrice}, {"maxPrice", maxPrice}},
+             {{"filterType", "LOT_SIZE"}, {"stepSize", stepSize}, {"minQty", minQty}, {"maxQty", maxQty}},
+             {{"filterType", "MARKET_LOT_SIZE"}, {"stepSize", marketStepSize}, {"minQty", minQty}, {"maxQty", marketMaxQty}},
+             {{"filterType", "MIN_NOTIONAL"}, {"notional", notional}},
+         })}
+    };
+}
+
+// Payloads as the exchange sends them: every number is decimal text, tick
+// and step sizes carry trailing zeros, and maxQty can have more decimals
+// than the step allows.
+json btc() {
+    return symbol_entry("BTCUSDT", "0.10", "556.80", "4529764", "0.001", "0.001", "1000", "0.001", "120", "100");
+}
+
+json eth() {
+    return symbol_entry("ETHUSDT", "0.05", "39.86", "306177", "0.001", "0.010", "10000", "0.010", "2000", "20");
+}
+
+json doge() {
+    return symbol_entry("DOGEUSDT", "0.000010", "0.002440", "30", "1", "1", "50000000.12345678", "1", "30000000", "5");
+}
+
+json xrp() {
+    return symbol_entry("XRPUSDT", "0.0001", "0.0143", "100000", "0.1", "0.1", "10000000", "0.1", "2000000", "5");
+}
+
+json sol() {
+    return symbol_entry("SOLUSDT", "0.0100", "0.4200", "6857", "1", "1", "1000000", "1", "5000", "5");
+}
+
+json exchange_info(json symbols) {
+    return json{{"timezone", "UTC"}, {"symbols", std::move(symbols)}};
+}
+
+Verdict check(const ExchangeInfoCache& cache, const std::string& symbol, OrderCheck order) {
+    auto rules = cache.rules(symbol);
+    return rules ? ExchangeInfoCache::validate(*rules, order) : Verdict::UNKNOWN_SYMBOL;
+}
+
+OrderCheck limit(double quantity, double price) {
+    OrderCheck order;
+    order.quantity = quantity;
+    order.price = price;
+    return order;
+}
+
+OrderCheck market(double quantity) {
+    OrderCheck order;
+    order.market = true;
+    order.quantity = quantity;
+    return order;
+}
+}  // namespace
+
+int main() {
+    ExchangeInfoCache cache;
+
+    // Brackets can arrive before exchangeInfo. The symbol is known but does
+    // not trade until exchangeInfo lists it.
+    cache.loadLeverageBrackets(json::array({
+        {{"symbol", "ETHUSDT"},
+         {"brackets",
+          json::array({
+              {{"bracket", 1}, {"initialLeverage", 125}, {"notionalCap", 10000}},
+              {{"bracket", 2}, {"initialLeverage", 100}, {"notionalCap", "100000"}},
+              {{"bracket", 3}, {"initialLeverage", 50}, {"notionalCap", 500000}},
+          })}},
+    }));
+    CHECK(!cache.loaded());
+    const ExchangeInfoCache::SymbolId ethId = cache.symbolId("ETHUSDT");
+    CHECK(ethId == 0);
+    CHECK(check(cache, "ETHUSDT", limit(1.0, 2000.0)) == Verdict::NOT_TRADING);
+
+    cache.load(exchange_info(json::array({btc(), eth(), doge(), xrp()})));
+    CHECK(cache.loaded());
+    CHECK(cache.size() == 4);
+    CHECK(cache.symbolId("ETHUSDT") == ethId);
+    CHECK(cache.symbolId("NOPEUSDT") == ExchangeInfoCache::kUnknownSymbol);
+    CHECK(!cache.rules("NOPEUSDT"));
+
+    // Filter text parses to integer units at the increments' own precision:
+    // "0.10" is one decimal, "0.000010" five, and maxQty's extra decimals
+    // beyond a whole-number step are dropped.
+    const auto btcRules = cache.rules("BTCUSDT");
+    const auto dogeRules = cache.rules("DOGEUSDT");
+    const auto ethRules = cache.rules("ETHUSDT");
+    CHECK(btcRules && dogeRules && ethRules);
+    if (!btcRules || !dogeRules || !ethRules) {
+        return check_exit_code();
+    }
+    CHECK(btcRules->priceDecimals == 1 && btcRules->tickSize == 1 && btcRules->minPrice == 5568);
+    CHECK(btcRules->quantityDecimals == 3 && btcRules->stepSize == 1 && btcRules->maxQty == 1000000);
+    CHECK(dogeRules->priceDecimals == 5 && dogeRules->tickSize == 1 && dogeRules->minPrice == 244);
+    CHECK(dogeRules->quantityDecimals == 0 && dogeRules->maxQty == 50000000);
+    CHECK(ethRules->priceDecimals == 2 && ethRules->tickSize == 5);
+    CHECK(ethRules->stepSize == 1 && ethRules->marketStepSize == 10 && ethRules->minQty == 10);
+    CHECK(ethRules->brackets.size() == 3);
+
+    const json btcJson = ExchangeInfoCache::toJson(*btcRules);
+    CHECK(btcJson["tickSize"] == "0.1");
+    CHECK(btcJson["minPrice"] == "556.8");
+    CHECK(btcJson["maxPrice"] == "4529764.0");
+    CHECK(btcJson["stepSize"] == "0.001");
+    CHECK(btcJson["marketMaxQty"] == "120.000");
+    const json dogeJson = ExchangeInfoCache::toJson(*dogeRules);
+    CHECK(dogeJson["tickSize"] == "0.00001");
+    CHECK(dogeJson["minPrice"] == "0.00244");
+    CHECK(dogeJson["maxQty"] == "50000000");
+
+    // Formatting: leading zeros, negatives and zero decimals.
+    CHECK(ExchangeInfoCache::formatPrice(*dogeRules, 0.0003) == "0.00030");
+    CHECK(ExchangeInfoCache::formatPrice(*dogeRules, 0.00001) == "0.00001");
+    CHECK(ExchangeInfoCache::formatPrice(*dogeRules, -0.00001) == "-0.00001");
+    CHECK(ExchangeInfoCache::formatPrice(*btcRules, 30000.1) == "30000.1");
+    CHECK(ExchangeInfoCache::formatPrice(*btcRules, -1.5) == "-1.5");
+    CHECK(ExchangeInfoCache::formatPrice(*btcRules, 0.0) == "0.0");
+    CHECK(ExchangeInfoCache::formatQuantity(*dogeRules, 25.0) == "25");
+    CHECK(ExchangeInfoCache::formatQuantity(*btcRules, 0.1 + 0.2) == "0.300");
+    CHECK(ExchangeInfoCache::formatQuantity(*ethRules, 12.345) == "12.345");
+
+    // Prices.
+    CHECK(check(cache, "BTCUSDT", limit(1.0, 30000.1)) == Verdict::OK);
+    CHECK(check(cache, "BTCUSDT", limit(1.0, 30000.15)) == Verdict::PRICE_PRECISION);
+    CHECK(check(cache, "BTCUSDT", limit(1.0, 1e300)) == Verdict::PRICE_PRECISION);
+    CHECK(check(cache, "BTCUSDT", limit(1.0, 556.7)) == Verdict::PRICE_TOO_LOW);
+    CHECK(check(cache, "BTCUSDT", limit(1.0, 556.8)) == Verdict::OK);
+    CHECK(check(cache, "BTCUSDT", limit(1.0, 4529764.1)) == Verdict::PRICE_TOO_HIGH);
+    CHECK(check(cache, "ETHUSDT", limit(1.0, 2000.05)) == Verdict::OK);
+    CHECK(check(cache, "ETHUSDT", limit(1.0, 2000.03)) == Verdict::PRICE_TICK);
+    // Binary rounding of a decimal sum is not a precision error.
+    CHECK(check(cache, "DOGEUSDT", limit(100.0, 0.1 + 0.2)) == Verdict::OK);
+    OrderCheck stop = market(0.01);
+    stop.stopPrice = 556.75;
+    CHECK(check(cache, "BTCUSDT", stop) == Verdict::PRICE_PRECISION);
+
+    // Quantities, with market orders held to MARKET_LOT_SIZE.
+    CHECK(check(cache, "BTCUSDT", market(0.1 + 0.2)) == Verdict::OK);
+    CHECK(check(cache, "BTCUSDT", market(0.0015)) == Verdict::QUANTITY_PRECISION);
+    CHECK(check(cache, "BTCUSDT", market(0.0)) == Verdict::QUANTITY_NOT_POSITIVE);
+    CHECK(check(cache, "BTCUSDT", market(-0.001)) == Verdict::QUANTITY_NOT_POSITIVE);
+    CHECK(check(cache, "ETHUSDT", limit(0.015, 2000.0)) == Verdict::OK);
+    CHECK(check(cache, "ETHUSDT", market(0.015)) == Verdict::QUANTITY_STEP);
+    CHECK(check(cache, "ETHUSDT", limit(0.005, 2000.0)) == Verdict::QUANTITY_TOO_LOW);
+    CHECK(check(cache, "BTCUSDT", limit(120.001, 30000.0)) == Verdict::OK);
+    CHECK(check(cache, "BTCUSDT", market(120.001)) == Verdict::QUANTITY_TOO_HIGH);
+    CHECK(check(cache, "BTCUSDT", limit(1000.001, 30000.0)) == Verdict::QUANTITY_TOO_HIGH);
+    CHECK(check(cache, "DOGEUSDT", limit(50000000.0, 0.1)) == Verdict::OK);
+    CHECK(check(cache, "DOGEUSDT", limit(50000001.0, 0.1)) == Verdict::QUANTITY_TOO_HIGH);
+
+    // Notional, exempt for reduce-only orders; exactly the minimum passes.
+    CHECK(check(cache, "BTCUSDT", limit(0.003, 30000.0)) == Verdict::NOTIONAL_TOO_SMALL);
+    OrderCheck reducing = limit(0.003, 30000.0);
+    reducing.reduceOnly = true;
+    CHECK(check(cache, "BTCUSDT", reducing) == Verdict::OK);
+    CHECK(check(cache, "BTCUSDT", limit(0.005, 20000.0)) == Verdict::OK);
+
+    // Brackets: the cap at a leverage is the largest among brackets that
+    // allow at least that leverage.
+    CHECK(ExchangeInfoCache::maxNotional(*ethRules, 125) == 10000.0);
+    CHECK(ExchangeInfoCache::maxNotional(*ethRules, 100) == 100000.0);
+    CHECK(ExchangeInfoCache::maxNotional(*ethRules, 20) == 500000.0);
+    CHECK(ExchangeInfoCache::maxNotional(*ethRules, 126) == 0.0);
+    CHECK(std::isinf(ExchangeInfoCache::maxNotional(*btcRules, 125)));
+    OrderCheck leveraged = limit(60.0, 2000.0);
+    leveraged.leverage = 100;
+    CHECK(check(cache, "ETHUSDT", leveraged) == Verdict::LEVERAGE_NOTIONAL_EXCEEDED);
+    leveraged.leverage = 50;
+    CHECK(check(cache, "ETHUSDT", leveraged) == Verdict::OK);
+    leveraged.quantity = 50.0;
+    leveraged.leverage = 100;
+    CHECK(check(cache, "ETHUSDT", leveraged) == Verdict::OK);
+
+    CHECK(ExchangeInfoCache::errorCode(Verdict::PRICE_TICK) == -4014);
+    CHECK(ExchangeInfoCache::errorCode(Verdict::LEVERAGE_NOTIONAL_EXCEEDED) == -2027);
+
+    // A reload drops XRPUSDT and lists SOLUSDT. Every id stays where it was,
+    // the dropped symbol stops trading, the new one is appended and the
+    // brackets loaded earlier are kept.
+    const ExchangeInfoCache::SymbolId btcId = cache.symbolId("BTCUSDT");
+    const ExchangeInfoCache::SymbolId xrpId = cache.symbolId("XRPUSDT");
+    const auto xrpBefore = cache.rules(xrpId);
+    json cheaperBtc = btc();
+    cheaperBtc["filters"][3]["notional"] = "50";
+    cache.load(exchange_info(json::array({sol(), cheaperBtc, eth(), doge()})));
+    CHECK(cache.size() == 5);
+    CHECK(cache.symbolId("BTCUSDT") == btcId);
+    CHECK(cache.symbolId("ETHUSDT") == ethId);
+    CHECK(cache.symbolId("XRPUSDT") == xrpId);
+    CHECK(cache.symbolId("SOLUSDT") == 4);
+    CHECK(check(cache, "XRPUSDT", limit(100.0, 0.5)) == Verdict::NOT_TRADING);
+    CHECK(check(cache, "SOLUSDT", limit(1.0, 150.01)) == Verdict::OK);
+    CHECK(check(cache, "BTCUSDT", limit(0.003, 30000.0)) == Verdict::OK);
+    CHECK(cache.rules("ETHUSDT") && cache.rules("ETHUSDT")->brackets.size() == 3);
+    // Rules already handed out belong to the snapshot they came from.
+    CHECK(xrpBefore && xrpBefore->trading);
+    CHECK(btcRules->minNotional == 100.0);
+
+    // A payload with a precision the tables cannot hold is refused whole.
+    bool refused = false;
+    try {
+        cache.load(exchange_info(json::array({symbol_entry("TINYUSDT", "0.00000000000000001", "0", "0", "1", "1", "0", "1", "0", "5")})));
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    CHECK(refused);
+    CHECK(cache.size() == 5);
+    CHECK(cache.symbolId("TINYUSDT") == ExchangeInfoCache::kUnknownSymbol);
+
+    return check_exit_code();
+}
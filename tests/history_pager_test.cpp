@@ -0,0 +1,191 @@
+#include "check.hpp"
+#include "history_pager.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using json = nlohmann::json;
+using Range = HistoryPager::Range;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr long long kDayMs = 24LL * 60 * 60 * 1000;
+constexpr long long kStart = 1704067200000;  // 2024-01-01 00:00 UTC
+
+struct Entry {
+    long long time;
+    long long id;
+    std::string incomeType;
+};
+
+// Serves pages from a fixed history the way the exchange does: entries in
+// [startTime, endTime] by ascending time, at most `limit` of them. It
+// rejects order windows of 7 days or more, like the -1127 error, and
+// records every request and how many overlapped.
+class FakeClient {
+public:
+    explicit FakeClient(std::vector<Entry> entries) : entries_(std::move(entries)) {
+        std::stable_sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    }
+
+    json getAllOrders(const std::string& symbol, const Range& range, int limit) {
+        if (range.startTime && range.endTime && *range.endTime - *range.startTime >= 7 * kDayMs) {
+            throw std::runtime_error("More than 7 days between startTime and endTime");
+        }
+        return serve(range, limit, [&](const Entry& entry) {
+            return json{{"symbol", symbol}, {"orderId", entry.id}, {"time", entry.time}};
+        });
+    }
+
+    json getIncomeHistory(const std::string& symbol, const std::string& incomeType, const Range& range, int limit) {
+        return serve(range, limit, [&](const Entry& entry) -> json {
+            if (!incomeType.empty() && entry.incomeType != incomeType) {
+                return nullptr;
+            }
+            return json{{"symbol", symbol}, {"incomeType", entry.incomeType}, {"tranId", entry.id}, {"time", entry.time}};
+        });
+    }
+
+    const std::vector<Range>& requests() const { return requests_; }
+    std::size_t requestCount() const { return requestCount_.load(); }
+    int maxInFlight() const { return maxInFlight_.load(); }
+
+private:
+    template <typename ToJson>
+    json serve(const Range& range, int limit, ToJson toJson) {
+        const int inFlight = ++inFlight_;
+        maxInFlight_ = std::max(maxInFlight_.load(), inFlight);
+        // Long enough for an eager second fetch to overlap this one.
+        std::this_thread::sleep_for(1ms);
+
+        json page = json::array();
+        for (const auto& entry : entries_) {
+            if (static_cast<int>(page.size()) >= limit) {
+                break;
+            }
+            if ((range.startTime && entry.time < *range.startTime) || (range.endTime && entry.time > *range.endTime)) {
+                continue;
+            }
+            json item = toJson(entry);
+            if (!item.is_null()) {
+                page.push_back(std::move(item));
+            }
+        }
+        requests_.push_back(range);
+        ++requestCount_;
+        --inFlight_;
+        return page;
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<Range> requests_;
+    std::atomic<std::size_t> requestCount_{0};
+    std::atomic<int> inFlight_{0};
+    std::atomic<int> maxInFlight_{0};
+};
+
+std::vector<long long> collect(HistoryPager& pager, const char* idKey) {
+    std::vector<long long> ids;
+    pager.forEach([&](const json& entry) { ids.push_back(entry.at(idKey).get<long long>()); });
+    return ids;
+}
+}  // namespace
+
+int main() {
+    // Orders on the first day, three sharing a millisecond across a page
+    // boundary, then two years of nothing before a last burst.
+    const long long quietEnd = kStart + 730 * kDayMs;
+    FakeClient orders({{kStart + 1000, 1, ""},
+                       {kStart + 2000, 2, ""},
+                       {kStart + 3000, 3, ""},
+                       {kStart + 5000, 4, ""},
+                       {kStart + 5000, 5, ""},
+                       {kStart + 5000, 6, ""},
+                       {kStart + 9000, 7, ""},
+                       {kStart + 10 * kDayMs, 8, ""},
+                       {quietEnd, 9, ""},
+                       {quietEnd + 1, 10, ""}});
+    {
+        auto pager = HistoryPager::allOrders(orders, "BTCUSDT", Range{kStart, quietEnd + kDayMs, std::nullopt}, 4);
+
+        // Only the first page is fetched ahead of the caller.
+        std::this_thread::sleep_for(20ms);
+        CHECK(orders.requestCount() == 1);
+
+        // Boundary entries come once each, and the quiet windows in between
+        // are skipped without ending the walk.
+        CHECK(collect(pager, "orderId") == (std::vector<long long>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+    }
+    CHECK(orders.maxInFlight() == 1);
+
+    // Windows are shorter than 7 days and cover the range without gaps: a
+    // full page continues from its last timestamp, any other page moves to
+    // the next window.
+    const auto& windows = orders.requests();
+    CHECK(windows.size() > 100);
+    CHECK(!windows.empty() && *windows.front().startTime == kStart);
+    CHECK(!windows.empty() && *windows.back().endTime == quietEnd + kDayMs);
+    CHECK(windows.size() > 1 && *windows[1].startTime == kStart + 5000 && *windows[1].endTime == *windows[0].endTime);
+    for (std::size_t i = 0; i < windows.size(); ++i) {
+        CHECK(*windows[i].endTime - *windows[i].startTime < 7 * kDayMs);
+        CHECK(!windows[i].fromId);
+        if (i > 0) {
+            const bool sameWindow = *windows[i].endTime == *windows[i - 1].endTime && *windows[i].startTime >= *windows[i - 1].startTime;
+            CHECK(sameWindow || *windows[i].startTime == *windows[i - 1].endTime + 1);
+        }
+    }
+
+    // Income pages by time from the epoch. tranIds repeat across income
+    // types, so the REALIZED_PNL entry sharing the boundary timestamp and
+    // tranId with the COMMISSION already delivered must still come through.
+    FakeClient income({{kStart, 100, "FUNDING_FEE"},
+                       {kStart, 101, "FUNDING_FEE"},
+                       {kStart + 60000, 100, "COMMISSION"},
+                       {kStart + 60000, 100, "REALIZED_PNL"},
+                       {kStart + 120000, 102, "FUNDING_FEE"},
+                       {kStart + 180000, 103, "FUNDING_FEE"}});
+    {
+        auto pager = HistoryPager::income(income, "BTCUSDT", "", Range{}, 3);
+        std::vector<std::pair<std::string, long long>> seen;
+        pager.forEach([&](const json& entry) {
+            seen.emplace_back(entry.at("incomeType").get<std::string>(), entry.at("tranId").get<long long>());
+        });
+        CHECK(seen == (std::vector<std::pair<std::string, long long>>{{"FUNDING_FEE", 100},
+                                                                     {"FUNDING_FEE", 101},
+                                                                     {"COMMISSION", 100},
+                                                                     {"REALIZED_PNL", 100},
+                                                                     {"FUNDING_FEE", 102},
+                                                                     {"FUNDING_FEE", 103}}));
+    }
+    CHECK(!income.requests().empty() && income.requests().front().startTime == 0LL);
+    CHECK(income.maxInFlight() == 1);
+
+    // More entries in one millisecond than fit in a page cannot be paged
+    // past by time, and the pager says so rather than skipping them.
+    std::vector<Entry> crowded;
+    for (long long id = 1; id <= 5; ++id) {
+        crowded.push_back({kStart + 5000, id, ""});
+    }
+    FakeClient stuck(crowded);
+    {
+        auto pager = HistoryPager::allOrders(stuck, "BTCUSDT", Range{kStart, kStart + kDayMs, std::nullopt}, 4);
+        auto first = pager.next();
+        CHECK(first && first->size() == 4);
+        bool threw = false;
+        try {
+            pager.next();
+        } catch (const std::runtime_error& error) {
+            threw = std::string(error.what()).find("raise pageSize") != std::string::npos;
+        }
+        CHECK(threw);
+    }
+
+    return check_exit_code();
+}
@@ -0,0 +1,156 @@
+#include "check.hpp"
+#include "kline_aggregator.hpp"
+#include "kline_series.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr std::int64_t kMinuteMs = 60 * 1000;
+
+// Deterministic pseudo-random walk, so failures reproduce.
+class Lcg {
+public:
+    explicit Lcg(std::uint64_t seed) : state_(seed) {}
+
+    double next() {
+        state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<double>(state_ >> 11) / static_cast<double>(1ULL << 53);
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+void append_row(KlineSeries& series, const KlineSeries& source, std::size_t i) {
+    series.openTime.push_back(source.openTime[i]);
+    series.open.push_back(source.open[i]);
+    series.high.push_back(source.high[i]);
+    series.low.push_back(source.low[i]);
+    series.close.push_back(source.close[i]);
+    series.volume.push_back(source.volume[i]);
+    series.quoteVolume.push_back(source.quoteVolume[i]);
+    series.trades.push_back(source.trades[i]);
+    series.takerBuyVolume.push_back(source.takerBuyVolume[i]);
+    series.takerBuyQuoteVolume.push_back(source.takerBuyQuoteVolume[i]);
+}
+
+// Ten days of 1m candles from an unaligned start, with gaps inside a 5m
+// bucket, across hour boundaries, over a whole 4h bucket and at a bucket's
+// final minute.
+KlineSeries minute_candles() {
+    const std::int64_t start = 1704289020000;  // 2024-01-03 13:37 UTC, a Wednesday
+    const std::size_t minutes = 10 * 24 * 60;
+    auto skipped = [](std::size_t m) {
+        return (m >= 100 && m < 107) || (m >= 500 && m < 620) || (m >= 2000 && m < 2400) || m == 3002 || m == minutes - 1;
+    };
+
+    KlineSeries series("1m");
+    Lcg random(42);
+    double price = 100.0;
+    for (std::size_t m = 0; m < minutes; ++m) {
+        const double open = price;
+        price *= 1.0 + (random.next() - 0.5) * 0.004;
+        if (skipped(m)) {
+            continue;
+        }
+        const double volume = random.next() * 10.0;
+        series.openTime.push_back(start + static_cast<std::int64_t>(m) * kMinuteMs);
+        series.open.push_back(open);
+        series.high.push_back(std::max(open, price) * (1.0 + random.next() * 0.001));
+        series.low.push_back(std::min(open, price) * (1.0 - random.next() * 0.001));
+        series.close.push_back(price);
+        series.volume.push_back(volume);
+        series.quoteVolume.push_back(volume * price);
+        series.trades.push_back(static_cast<std::int64_t>(random.next() * 50.0));
+        series.takerBuyVolume.push_back(volume * random.next());
+        series.takerBuyQuoteVolume.push_back(volume * random.next() * price);
+    }
+    return series;
+}
+
+// Folding is done in the same order on both paths, so every column must
+// match exactly.
+bool same_series(const KlineSeries& a, const KlineSeries& b) {
+    return a.interval == b.interval && a.openTime == b.openTime && a.open == b.open && a.high == b.high &&
+           a.low == b.low && a.close == b.close && a.volume == b.volume && a.quoteVolume == b.quoteVolume &&
+           a.trades == b.trades && a.takerBuyVolume == b.takerBuyVolume && a.takerBuyQuoteVolume == b.takerBuyQuoteVolume;
+}
+
+// Feeds rows [begin, end) of `source` into an aggregator through a growing
+// copy, in uneven chunks as a live feed would deliver them.
+void check_incremental(const KlineSeries& source, const std::vector<std::string>& intervals, std::size_t begin, std::size_t end) {
+    KlineAggregator aggregator(source.interval, intervals);
+    std::vector<std::size_t> closes(intervals.size(), 0);
+    std::vector<std::int64_t> lastClosed(intervals.size(), -1);
+    aggregator.setCloseCallback([&](const KlineSeries& series, std::size_t index) {
+        for (std::size_t t = 0; t < intervals.size(); ++t) {
+            if (intervals[t] == series.interval) {
+                CHECK(series.openTime[index] > lastClosed[t]);
+                lastClosed[t] = series.openTime[index];
+                ++closes[t];
+            }
+        }
+    });
+
+    KlineSeries feed(source.interval);
+    Lcg random(7);
+    std::size_t next = begin;
+    while (next < end) {
+        const std::size_t chunk = std::min<std::size_t>(1 + static_cast<std::size_t>(random.next() * 50.0), end - next);
+        for (std::size_t i = next; i < next + chunk; ++i) {
+            append_row(feed, source, i);
+        }
+        next += chunk;
+        aggregator.appendNew(feed);
+    }
+
+    const std::int64_t lastSourceClose = source.closeTime(end - 1);
+    for (std::size_t t = 0; t < intervals.size(); ++t) {
+        const KlineSeries batch = KlineAggregator::aggregate(source, intervals[t], begin, end);
+        const KlineSeries& incremental = aggregator.series(intervals[t]);
+        CHECK(!batch.empty());
+        CHECK(same_series(batch, incremental));
+
+        // Every bucket but the last has closed; the last only if the source
+        // reached its final minute.
+        const std::size_t expectedClosed = batch.size() - (batch.closeTime(batch.size() - 1) == lastSourceClose ? 0 : 1);
+        CHECK(aggregator.closedCount(intervals[t]) == expectedClosed);
+        CHECK(closes[t] == expectedClosed);
+    }
+}
+}  // namespace
+
+int main() {
+    const KlineSeries source = minute_candles();
+    const std::vector<std::string> intervals = {"3m", "5m", "15m", "30m", "1h", "2h", "4h", "6h", "8h", "12h", "1d", "3d", "1w"};
+
+    // The whole history, then a window starting and ending mid-bucket like
+    // the simulator's derived klines.
+    check_incremental(source, intervals, 0, source.size());
+    check_incremental(source, intervals, 1234, source.size() - 4321);
+
+    // Gaps leave buckets out rather than emitting empty candles.
+    const KlineSeries hourly = KlineAggregator::aggregate(source, "1h");
+    for (std::size_t i = 0; i < hourly.size(); ++i) {
+        CHECK(hourly.openTime[i] % (60 * kMinuteMs) == 0);
+        CHECK(hourly.low[i] <= hourly.open[i] && hourly.open[i] <= hourly.high[i]);
+        CHECK(hourly.low[i] <= hourly.close[i] && hourly.close[i] <= hourly.high[i]);
+    }
+    const KlineSeries fourHourly = KlineAggregator::aggregate(source, "4h");
+    std::size_t missing = 0;
+    for (std::size_t i = 1; i < fourHourly.size(); ++i) {
+        missing += static_cast<std::size_t>((fourHourly.openTime[i] - fourHourly.openTime[i - 1]) / fourHourly.intervalMs - 1);
+    }
+    CHECK(missing == 1);
+
+    // Weekly candles open on Monday 00:00 UTC.
+    const KlineSeries weekly = KlineAggregator::aggregate(source, "1w");
+    CHECK(weekly.size() == 2);
+    CHECK(weekly.size() == 2 && weekly.openTime[1] == 1704672000000);  // 2024-01-08
+
+    return check_exit_code();
+}
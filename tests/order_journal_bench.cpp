@@ -0,0 +1,148 @@
+#include "order_journal.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Cost of OrderJournal::record on the calling thread, next to the cost of
+// copying the same bytes into a ring-sized buffer. Built with the tests but
+// not run by ctest, since timings depend on the machine. Numbers are only
+// meaningful from a Release build:
+//
+//   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build --target order_journal_bench
+//   build/order_journal_bench [COUNT]
+
+using json = nlohmann::json;
+
+namespace {
+const std::string kPath = "/fapi/v1/order";
+
+const std::string kOrderRequest =
+    "symbol=ETHUSDT&side=BUY&type=LIMIT&quantity=0.010&price=2500.50&timeInForce=GTC&positionSide=BOTH"
+    "&newClientOrderId=bench-000001&timestamp=1700000000000&recvWindow=5000"
+    "&signature=3f5d0b1f0f2e6f8d9c1b2a3e4f5a6b7c8d9e0f1a2b3c4d5e6f7a8b9c0d1e2f3a";
+
+// A complete /fapi/v1/order acknowledgement as the exchange returns it.
+const std::string kOrderAck =
+    "{\"orderId\":8389765512345678,\"symbol\":\"ETHUSDT\",\"status\":\"NEW\",\"clientOrderId\":\"bench-000001\","
+    "\"price\":\"2500.50\",\"avgPrice\":\"0.00\",\"origQty\":\"0.010\",\"executedQty\":\"0.000\",\"cumQty\":\"0.000\","
+    "\"cumQuote\":\"0.00000\",\"timeInForce\":\"GTC\",\"type\":\"LIMIT\",\"reduceOnly\":false,\"closePosition\":false,"
+    "\"side\":\"BUY\",\"positionSide\":\"BOTH\",\"stopPrice\":\"0.00\",\"workingType\":\"CONTRACT_PRICE\","
+    "\"priceProtect\":false,\"origType\":\"LIMIT\",\"priceMatch\":\"NONE\",\"selfTradePreventionMode\":\"EXPIRE_MAKER\","
+    "\"goodTillDate\":0,\"activatePrice\":\"0.00\",\"priceRate\":\"0.0\",\"updateTime\":1700000000123,"
+    "\"time\":1700000000123,\"orderListId\":-1,\"rateLimits\":[{\"rateLimitType\":\"ORDERS\","
+    "\"interval\":\"SECOND\",\"intervalNum\":10,\"limit\":300,\"count\":1}]}";
+
+const std::string kCancelRequest =
+    "symbol=ETHUSDT&origClientOrderId=bench-000001&timestamp=1700000000000&recvWindow=5000"
+    "&signature=3f5d0b1f0f2e6f8d9c1b2a3e4f5a6b7c8d9e0f1a2b3c4d5e6f7a8b9c0d1e2f3a";
+
+const std::string kCancelAck =
+    "{\"orderId\":8389765512345678,\"symbol\":\"ETHUSDT\",\"status\":\"CANCELED\",\"clientOrderId\":\"bench-000001\","
+    "\"updateTime\":1700000000456}";
+
+double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+std::size_t blocks_for(std::size_t payloadBytes) {
+    const std::size_t recordData = sizeof(JournalRecord::data);
+    const std::size_t continuationData = sizeof(JournalContinuation::data);
+    return 1 + (payloadBytes > recordData ? (payloadBytes - recordData + continuationData - 1) / continuationData : 0);
+}
+
+// Records in bursts that fit in the ring, so the timing is the producer's
+// own cost rather than back-pressure from the writer thread. The first
+// pass over the ring is untimed to fault its pages in.
+json bench(const std::string& name,
+           const std::string& directory,
+           const std::string& request,
+           const std::string& response,
+           std::size_t count) {
+    std::filesystem::remove_all(directory);
+    OrderJournal::Options options;
+    options.directory = directory;
+    OrderJournal journal(options);
+
+    const std::size_t payloadBytes = request.size() + response.size();
+    const std::size_t blocks = blocks_for(payloadBytes);
+    const std::size_t burst = std::max<std::size_t>(options.ringCapacity / 2 / blocks, 1);
+    for (std::size_t i = 0; i < options.ringCapacity; i += burst) {
+        for (std::size_t j = 0; j < burst; ++j) {
+            journal.record("POST", kPath, request, response, "bench-000001", 200, 0, 0, 1000);
+        }
+        journal.flush();
+    }
+
+    std::vector<double> recordNs;
+    for (std::size_t done = 0; done < count; done += burst) {
+        const std::size_t n = std::min(burst, count - done);
+        const auto started = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            journal.record("POST", kPath, request, response, "bench-000001", 200, 0, 0, 1000);
+        }
+        const auto took = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+        recordNs.push_back(static_cast<double>(took.count()) / static_cast<double>(n));
+        journal.flush();
+    }
+
+    // The same bytes copied into the same number of 1 KiB blocks, with no
+    // journal around them: the floor any copying journal pays.
+    std::vector<char> ring(options.ringCapacity * sizeof(JournalRecord));
+    std::vector<double> copyNs;
+    std::size_t offset = 0;
+    for (std::size_t done = 0; done < count; done += burst) {
+        const std::size_t n = std::min(burst, count - done);
+        const auto started = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            char* out = ring.data() + offset;
+            std::memcpy(out, request.data(), request.size());
+            std::memcpy(out + request.size(), response.data(), response.size());
+            offset += blocks * sizeof(JournalRecord);
+            if (offset + blocks * sizeof(JournalRecord) > ring.size()) {
+                offset = 0;
+            }
+        }
+        const auto took = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+        copyNs.push_back(static_cast<double>(took.count()) / static_cast<double>(n));
+    }
+
+    journal.flush();
+    return json{
+        {"entry", name},
+        {"payloadBytes", payloadBytes},
+        {"blocksPerEntry", blocks},
+        {"recordNs", median(recordNs)},
+        {"copyNs", median(copyNs)},
+        {"written", journal.written()},
+        {"dropped", journal.dropped()}
+    };
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t count = argc > 1 ? std::stoul(argv[1]) : 200000;
+    const std::string directory =
+        (std::filesystem::temp_directory_path() / ("order_journal_bench-" + std::to_string(::getpid()))).string();
+
+    json results = json::array();
+    results.push_back(bench("cancel", directory, kCancelRequest, kCancelAck, count));
+    results.push_back(bench("order", directory, kOrderRequest, kOrderAck, count));
+    std::filesystem::remove_all(directory);
+
+    std::cout << results.dump(2) << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "check.hpp"
+#include "order_journal.hpp"
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr std::size_t kSegmentRecords = 4;
+
+struct Replayed {
+    std::uint64_t sequence;
+    std::string request;
+    std::string response;
+};
+
+OrderJournal::Options journal_options(const std::string& directory) {
+    OrderJournal::Options options;
+    options.directory = directory;
+    options.ringCapacity = 16;
+    options.segmentRecords = kSegmentRecords;
+    return options;
+}
+
+// Records `count` entries numbered from `first` and closes the journal, as
+// a process exiting would.
+void write_entries(const std::string& directory, int first, int count, std::size_t responseBytes = 16) {
+    OrderJournal journal(journal_options(directory));
+    for (int i = first; i < first + count; ++i) {
+        const std::string request = "symbol=BTCUSDT&newClientOrderId=entry-" + std::to_string(i);
+        const std::string response(responseBytes, static_cast<char>('a' + i % 26));
+        CHECK(journal.record("POST", "/fapi/v1/order", request, response, "entry-" + std::to_string(i), 200, 0, i, 1000));
+    }
+    journal.flush();
+    CHECK(journal.dropped() == 0);
+    CHECK(!journal.failed());
+}
+
+std::vector<Replayed> replay(const std::string& directory) {
+    std::vector<Replayed> entries;
+    JournalReader(directory).replay([&](const JournalEntry& entry) {
+        entries.push_back({entry.record.sequence, std::string(entry.request), std::string(entry.response)});
+    });
+    return entries;
+}
+
+std::size_t segment_count(const std::string& directory) {
+    std::size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        count += entry.is_regular_file() ? 1 : 0;
+    }
+    return count;
+}
+}  // namespace
+
+int main() {
+    const std::string directory =
+        (std::filesystem::temp_directory_path() / ("order_journal_test-" + std::to_string(::getpid()))).string();
+    std::filesystem::remove_all(directory);
+
+    // Six one-block entries fill segment 0 and start segment 1.
+    write_entries(directory, 1, 6);
+    CHECK(segment_count(directory) == 2);
+
+    // A restart resumes in segment 1. Entry 8 spans three blocks, no longer
+    // fits there and opens segment 2.
+    write_entries(directory, 7, 1);
+    write_entries(directory, 8, 1, 2500);
+    write_entries(directory, 9, 1);
+    CHECK(segment_count(directory) == 3);
+
+    // The process stopped right after rotating into segment 3: the file is
+    // allocated but holds no entries. Sequences carry on from segment 2.
+    {
+        std::ofstream empty(directory + "/journal-00000003.bin", std::ios::binary);
+        const std::string zeros(kSegmentRecords * sizeof(JournalRecord), '\0');
+        empty.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+    }
+    write_entries(directory, 10, 2);
+
+    // A torn entry, whose sequence was never set, at the head of the newest
+    // segment leaves it empty too.
+    {
+        std::ofstream torn(directory + "/journal-00000004.bin", std::ios::binary);
+        JournalRecord record{};
+        record.continuations = 1;
+        torn.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        const std::string zeros((kSegmentRecords - 1) * sizeof(JournalRecord), '\0');
+        torn.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+    }
+    write_entries(directory, 12, 1);
+
+    const std::vector<Replayed> entries = replay(directory);
+    CHECK(entries.size() == 12);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const int number = static_cast<int>(i) + 1;
+        CHECK(entries[i].sequence == static_cast<std::uint64_t>(number));
+        CHECK(entries[i].request == "symbol=BTCUSDT&newClientOrderId=entry-" + std::to_string(number));
+        CHECK(entries[i].response == std::string(number == 8 ? 2500 : 16, static_cast<char>('a' + number % 26)));
+    }
+
+    std::filesystem::remove_all(directory);
+    return check_exit_code();
+}
@@ -0,0 +1,158 @@
+#include "check.hpp"
+#include "risk_engine.hpp"
+#include "simulated_exchange.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+// Deterministic pseudo-random walk, so failures reproduce.
+class Lcg {
+public:
+    explicit Lcg(std::uint64_t seed) : state_(seed) {}
+
+    double next() {
+        state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<double>(state_ >> 11) / static_cast<double>(1ULL << 53);
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+std::shared_ptr<KlineSeries> hourly_candles(double price, std::uint64_t seed, std::size_t count) {
+    auto series = std::make_shared<KlineSeries>("1h");
+    Lcg random(seed);
+    for (std::size_t i = 0; i < count; ++i) {
+        const double open = price;
+        price *= 1.0 + (random.next() - 0.5) * 0.01;
+        series->openTime.push_back(1704067200000 + static_cast<std::int64_t>(i) * series->intervalMs);
+        series->open.push_back(open);
+        series->high.push_back(std::max(open, price) * 1.001);
+        series->low.push_back(std::min(open, price) * 0.999);
+        series->close.push_back(price);
+        series->volume.push_back(1.0);
+        series->quoteVolume.push_back(price);
+        series->trades.push_back(1);
+        series->takerBuyVolume.push_back(0.5);
+        series->takerBuyQuoteVolume.push_back(0.5 * price);
+    }
+    return series;
+}
+
+double number(const json& object, const char* key) {
+    const auto& value = object.at(key);
+    return value.is_string() ? std::stod(value.get<std::string>()) : value.get<double>();
+}
+
+// The simulator's payloads are rounded to eight decimals, which the engine
+// then computes from.
+bool close_to(double a, double b) {
+    return std::fabs(a - b) <= 1e-6 * std::max({1.0, std::fabs(a), std::fabs(b)});
+}
+
+void place_market(SimulatedExchange& exchange, const std::string& symbol, SimulatedExchange::Side side, double quantity) {
+    SimulatedExchange::OrderRequest request;
+    request.symbol = symbol;
+    request.side = side;
+    request.type = SimulatedExchange::OrderType::MARKET;
+    request.quantity = quantity;
+    exchange.placeOrder(request);
+}
+
+// Every open position must carry the same liquidation price, PnL and
+// maintenance margin in the engine as the simulator reports for it.
+void check_matches(SimulatedExchange& exchange, const RiskEngine& engine, RiskEngine::AccountId account) {
+    std::map<std::string, RiskEngine::PositionRisk> local;
+    for (const auto& position : engine.positions(account)) {
+        local[position.symbol] = position;
+    }
+
+    std::size_t open = 0;
+    for (const auto& position : exchange.getPositionRisk()) {
+        const std::string symbol = position.at("symbol").get<std::string>();
+        if (number(position, "positionAmt") == 0.0) {
+            CHECK(local.count(symbol) == 0);
+            continue;
+        }
+        ++open;
+        auto it = local.find(symbol);
+        CHECK(it != local.end());
+        if (it == local.end()) {
+            continue;
+        }
+        CHECK(close_to(it->second.positionAmt, number(position, "positionAmt")));
+        CHECK(close_to(it->second.markPrice, number(position, "markPrice")));
+        CHECK(close_to(it->second.unrealizedProfit, number(position, "unRealizedProfit")));
+        CHECK(close_to(it->second.liquidationPrice, number(position, "liquidationPrice")));
+    }
+    CHECK(open == local.size());
+
+    const json info = exchange.getAccountInfo();
+    const RiskEngine::AccountRisk risk = engine.account(account);
+    CHECK(close_to(risk.walletBalance, number(info, "totalWalletBalance")));
+    CHECK(close_to(risk.marginBalance, number(info, "totalMarginBalance")));
+    CHECK(close_to(risk.maintMargin, number(info, "totalMaintMargin")));
+}
+}  // namespace
+
+int main() {
+    using Side = SimulatedExchange::Side;
+    const std::vector<std::string> symbols = {"BTCUSDT", "ETHUSDT", "SOLUSDT"};
+
+    SimulatedExchange::Options options;
+    options.initialBalance = 10000.0;
+    options.takerFee = 0.0;
+    options.makerFee = 0.0;
+    options.maintenanceMarginRate = 0.004;
+    SimulatedExchange exchange(options);
+    exchange.addSymbol("BTCUSDT", hourly_candles(30000.0, 1, 240));
+    exchange.addSymbol("ETHUSDT", hourly_candles(2000.0, 2, 240));
+    exchange.addSymbol("SOLUSDT", hourly_candles(100.0, 3, 240));
+    exchange.step();
+
+    // A cross account that is long, short and long again, at different
+    // leverage, so each position's liquidation price depends on the others.
+    exchange.setLeverage("BTCUSDT", 20);
+    exchange.setLeverage("ETHUSDT", 10);
+    place_market(exchange, "BTCUSDT", Side::BUY, 0.5);
+    place_market(exchange, "ETHUSDT", Side::SELL, 5.0);
+    place_market(exchange, "SOLUSDT", Side::BUY, 40.0);
+
+    RiskEngine engine;
+    const RiskEngine::AccountId account = engine.addAccount("simulated");
+    engine.seedFrom(account, exchange);
+    check_matches(exchange, engine, account);
+
+    // From here the engine only sees mark ticks, until a fill changes the
+    // wallet and the account is seeded again.
+    std::size_t bars = 1;
+    while (exchange.step()) {
+        ++bars;
+        for (const auto& symbol : symbols) {
+            engine.onMarkPrice(symbol, exchange.klines(symbol).close[exchange.barIndex(symbol)]);
+        }
+        if (bars == 80) {
+            place_market(exchange, "BTCUSDT", Side::SELL, 0.2);
+            engine.seedFrom(account, exchange);
+        }
+        if (bars == 160) {
+            exchange.closePosition("ETHUSDT");
+            engine.seedFrom(account, exchange);
+        }
+        check_matches(exchange, engine, account);
+    }
+
+    CHECK(bars == 240);
+    CHECK(exchange.summary().at("liquidations").get<std::size_t>() == 0);
+
+    return check_exit_code();
+}
@@ -0,0 +1,37 @@
+#include "text_format.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+std::size_t format_decimal(char* buffer, double value) {
+    const int written = std::snprintf(buffer, kDecimalBufferSize, "%.8f", value);
+    if (written <= 0) {
+        buffer[0] = '0';
+        return 1;
+    }
+    std::size_t length = std::min(static_cast<std::size_t>(written), kDecimalBufferSize - 1);
+    while (length > 1 && buffer[length - 1] == '0') {
+        --length;
+    }
+    if (buffer[length - 1] == '.') {
+        --length;
+    }
+    if (length == 2 && buffer[0] == '-' && buffer[1] == '0') {
+        buffer[0] = '0';
+        length = 1;
+    }
+    return length;
+}
+
+std::string format_decimal(double value) {
+    char buffer[kDecimalBufferSize];
+    return std::string(buffer, format_decimal(buffer, value));
+}
+
+std::string uppercase(std::string value) {
+    for (auto& c : value) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return value;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Text conventions shared by the client, the simulator and the kline store.
+
+constexpr std::size_t kDecimalBufferSize = 64;
+
+// Writes `value` the way the exchange prints prices and quantities: fixed
+// point, at most eight decimals, no trailing zeros and never "-0". `buffer`
+// must hold kDecimalBufferSize bytes; returns the length written.
+std::size_t format_decimal(char* buffer, double value);
+
+std::string format_decimal(double value);
+
+std::string uppercase(std::string value);